@@ -0,0 +1,83 @@
+// Scaling benchmark for hll::ConcurrentSketch.
+//
+// For each thread count, the same stream of hashes is split across the
+// threads and loaded two ways: every thread updating one shared
+// ConcurrentSketch, and every thread filling a private Sketch that is merged
+// at the end. Both must produce the same blob.
+//
+//   make bench && ./build/concurrent_bench [items] [max_threads]
+
+#include <hll_sketch.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int LG_K = 14;
+
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+template <typename F>
+double timeThreads(int numThreads, uint64_t items, F&& body) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        uint64_t begin = items * t / numThreads;
+        uint64_t end = items * (t + 1) / numThreads;
+        threads.emplace_back([&body, t, begin, end] { body(t, begin, end); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint64_t items = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000000ULL;
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : 64;
+
+    printf("lgK=%d items=%llu hardware_threads=%u\n", LG_K,
+           static_cast<unsigned long long>(items), std::thread::hardware_concurrency());
+    printf("%8s %14s %14s %14s %10s\n", "threads", "shared Mops/s", "per-thread", "merge ms", "identical");
+
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        hll::ConcurrentSketch<LG_K> shared;
+        double sharedSecs = timeThreads(numThreads, items, [&shared](int, uint64_t begin, uint64_t end) {
+            for (uint64_t i = begin; i < end; ++i) {
+                shared.updateWithHash(splitmix64(i));
+            }
+        });
+
+        std::vector<std::unique_ptr<hll::Sketch<LG_K>>> locals(numThreads);
+        double localSecs = timeThreads(numThreads, items, [&locals](int t, uint64_t begin, uint64_t end) {
+            std::unique_ptr<hll::Sketch<LG_K>> local = std::make_unique<hll::Sketch<LG_K>>();
+            for (uint64_t i = begin; i < end; ++i) {
+                local->updateWithHash(splitmix64(i));
+            }
+            locals[t] = std::move(local);
+        });
+
+        auto mergeStart = std::chrono::steady_clock::now();
+        for (int t = 1; t < numThreads; ++t) {
+            locals[0]->merge(*locals[t]);
+        }
+        double mergeSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - mergeStart).count();
+
+        bool identical = shared.serialize() == locals[0]->serialize();
+        printf("%8d %14.1f %14.1f %14.3f %10s\n", numThreads,
+               items / sharedSecs / 1e6, items / (localSecs + mergeSecs) / 1e6,
+               mergeSecs * 1e3, identical ? "yes" : "NO");
+    }
+    return 0;
+}
@@ -80,6 +80,50 @@ int32_t __wasm_export_extension_hll_union_emptyisnull(int32_t arg, int32_t arg0,
   *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
   return ptr;
 }
+__attribute__((export_name("hll-delta")))
+int32_t __wasm_export_extension_hll_delta(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2) {
+  extension_list_u8_t arg3 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg1), (size_t)(arg2) };
+  extension_list_u8_t ret;
+  extension_hll_delta(&arg3, &arg4, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-delta-emptyisnull")))
+int32_t __wasm_export_extension_hll_delta_emptyisnull(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2) {
+  extension_list_u8_t arg3 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg1), (size_t)(arg2) };
+  extension_list_u8_t ret;
+  extension_hll_delta_emptyisnull(&arg3, &arg4, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-apply-delta")))
+int32_t __wasm_export_extension_hll_apply_delta(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2) {
+  extension_list_u8_t arg3 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg1), (size_t)(arg2) };
+  extension_list_u8_t ret;
+  extension_hll_apply_delta(&arg3, &arg4, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-apply-delta-emptyisnull")))
+int32_t __wasm_export_extension_hll_apply_delta_emptyisnull(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2) {
+  extension_list_u8_t arg3 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg1), (size_t)(arg2) };
+  extension_list_u8_t ret;
+  extension_hll_apply_delta_emptyisnull(&arg3, &arg4, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
 __attribute__((export_name("hll-hash")))
 int64_t __wasm_export_extension_hll_hash(int32_t arg, int32_t arg0) {
   extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
@@ -92,6 +136,68 @@ int64_t __wasm_export_extension_hll_hash_emptyisnull(int32_t arg, int32_t arg0)
   uint64_t ret = extension_hll_hash_emptyisnull(&arg1);
   return (int64_t) (ret);
 }
+__attribute__((export_name("hll-cache")))
+int32_t __wasm_export_extension_hll_cache(int32_t arg, int32_t arg0) {
+  extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_list_u8_t ret;
+  extension_hll_cache(&arg1, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-cache-emptyisnull")))
+int32_t __wasm_export_extension_hll_cache_emptyisnull(int32_t arg, int32_t arg0) {
+  extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_list_u8_t ret;
+  extension_hll_cache_emptyisnull(&arg1, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-from-datasketches")))
+int32_t __wasm_export_extension_hll_from_datasketches(int32_t arg, int32_t arg0) {
+  extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_list_u8_t ret;
+  extension_hll_from_datasketches(&arg1, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-from-datasketches-emptyisnull")))
+int32_t __wasm_export_extension_hll_from_datasketches_emptyisnull(int32_t arg, int32_t arg0) {
+  extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_list_u8_t ret;
+  extension_hll_from_datasketches_emptyisnull(&arg1, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-to-datasketches")))
+int32_t __wasm_export_extension_hll_to_datasketches(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2) {
+  extension_list_u8_t arg3 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_string_t arg4 = (extension_string_t) { (char*)(arg1), (size_t)(arg2) };
+  extension_list_u8_t ret;
+  extension_hll_to_datasketches(&arg3, &arg4, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-to-datasketches-emptyisnull")))
+int32_t __wasm_export_extension_hll_to_datasketches_emptyisnull(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2) {
+  extension_list_u8_t arg3 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_string_t arg4 = (extension_string_t) { (char*)(arg1), (size_t)(arg2) };
+  extension_list_u8_t ret;
+  extension_hll_to_datasketches_emptyisnull(&arg3, &arg4, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
 __attribute__((export_name("hll-print")))
 int32_t __wasm_export_extension_hll_print(int32_t arg, int32_t arg0) {
   extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
@@ -112,6 +218,26 @@ int32_t __wasm_export_extension_hll_print_emptyisnull(int32_t arg, int32_t arg0)
   *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
   return ptr;
 }
+__attribute__((export_name("hll-stats")))
+int32_t __wasm_export_extension_hll_stats(int32_t arg, int32_t arg0) {
+  extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_string_t ret;
+  extension_hll_stats(&arg1, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-stats-emptyisnull")))
+int32_t __wasm_export_extension_hll_stats_emptyisnull(int32_t arg, int32_t arg0) {
+  extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_string_t ret;
+  extension_hll_stats_emptyisnull(&arg1, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
 __attribute__((export_name("hll-empty")))
 int32_t __wasm_export_extension_hll_empty(void) {
   extension_state_t ret = extension_hll_empty();
@@ -129,6 +255,129 @@ int32_t __wasm_export_extension_hll_add_emptyisnull(int32_t arg, int32_t arg0, i
   extension_state_t ret = extension_hll_add_emptyisnull(arg, &arg2);
   return ret;
 }
+__attribute__((export_name("hll-add-split")))
+int32_t __wasm_export_extension_hll_add_split(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2, int32_t arg3) {
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg0), (size_t)(arg1) };
+  extension_string_t arg5 = (extension_string_t) { (char*)(arg2), (size_t)(arg3) };
+  extension_state_t ret = extension_hll_add_split(arg, &arg4, &arg5);
+  return ret;
+}
+__attribute__((export_name("hll-add-split-emptyisnull")))
+int32_t __wasm_export_extension_hll_add_split_emptyisnull(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2, int32_t arg3) {
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg0), (size_t)(arg1) };
+  extension_string_t arg5 = (extension_string_t) { (char*)(arg2), (size_t)(arg3) };
+  extension_state_t ret = extension_hll_add_split_emptyisnull(arg, &arg4, &arg5);
+  return ret;
+}
+__attribute__((export_name("hll-add-json-array")))
+int32_t __wasm_export_extension_hll_add_json_array(int32_t arg, int32_t arg0, int32_t arg1) {
+  extension_string_t arg2 = (extension_string_t) { (char*)(arg0), (size_t)(arg1) };
+  extension_state_t ret = extension_hll_add_json_array(arg, &arg2);
+  return ret;
+}
+__attribute__((export_name("hll-add-json-array-emptyisnull")))
+int32_t __wasm_export_extension_hll_add_json_array_emptyisnull(int32_t arg, int32_t arg0, int32_t arg1) {
+  extension_string_t arg2 = (extension_string_t) { (char*)(arg0), (size_t)(arg1) };
+  extension_state_t ret = extension_hll_add_json_array_emptyisnull(arg, &arg2);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi2")))
+int32_t __wasm_export_extension_hll_add_multi2(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2, int32_t arg3) {
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg0), (size_t)(arg1) };
+  extension_list_u8_t arg5 = (extension_list_u8_t) { (uint8_t*)(arg2), (size_t)(arg3) };
+  extension_state_t ret = extension_hll_add_multi2(arg, &arg4, &arg5);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi2-emptyisnull")))
+int32_t __wasm_export_extension_hll_add_multi2_emptyisnull(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2, int32_t arg3) {
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg0), (size_t)(arg1) };
+  extension_list_u8_t arg5 = (extension_list_u8_t) { (uint8_t*)(arg2), (size_t)(arg3) };
+  extension_state_t ret = extension_hll_add_multi2_emptyisnull(arg, &arg4, &arg5);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi3")))
+int32_t __wasm_export_extension_hll_add_multi3(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2, int32_t arg3, int32_t arg4, int32_t arg5) {
+  extension_list_u8_t arg6 = (extension_list_u8_t) { (uint8_t*)(arg0), (size_t)(arg1) };
+  extension_list_u8_t arg7 = (extension_list_u8_t) { (uint8_t*)(arg2), (size_t)(arg3) };
+  extension_list_u8_t arg8 = (extension_list_u8_t) { (uint8_t*)(arg4), (size_t)(arg5) };
+  extension_state_t ret = extension_hll_add_multi3(arg, &arg6, &arg7, &arg8);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi3-emptyisnull")))
+int32_t __wasm_export_extension_hll_add_multi3_emptyisnull(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2, int32_t arg3, int32_t arg4, int32_t arg5) {
+  extension_list_u8_t arg6 = (extension_list_u8_t) { (uint8_t*)(arg0), (size_t)(arg1) };
+  extension_list_u8_t arg7 = (extension_list_u8_t) { (uint8_t*)(arg2), (size_t)(arg3) };
+  extension_list_u8_t arg8 = (extension_list_u8_t) { (uint8_t*)(arg4), (size_t)(arg5) };
+  extension_state_t ret = extension_hll_add_multi3_emptyisnull(arg, &arg6, &arg7, &arg8);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi2-int")))
+int32_t __wasm_export_extension_hll_add_multi2_int(int32_t arg, int64_t arg0, int64_t arg1) {
+  extension_state_t ret = extension_hll_add_multi2_int(arg, arg0, arg1);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi2-int-emptyisnull")))
+int32_t __wasm_export_extension_hll_add_multi2_int_emptyisnull(int32_t arg, int64_t arg0, int64_t arg1) {
+  extension_state_t ret = extension_hll_add_multi2_int_emptyisnull(arg, arg0, arg1);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi3-int")))
+int32_t __wasm_export_extension_hll_add_multi3_int(int32_t arg, int64_t arg0, int64_t arg1, int64_t arg2) {
+  extension_state_t ret = extension_hll_add_multi3_int(arg, arg0, arg1, arg2);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi3-int-emptyisnull")))
+int32_t __wasm_export_extension_hll_add_multi3_int_emptyisnull(int32_t arg, int64_t arg0, int64_t arg1, int64_t arg2) {
+  extension_state_t ret = extension_hll_add_multi3_int_emptyisnull(arg, arg0, arg1, arg2);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi-int-bytes")))
+int32_t __wasm_export_extension_hll_add_multi_int_bytes(int32_t arg, int64_t arg0, int32_t arg1, int32_t arg2) {
+  extension_list_u8_t arg3 = (extension_list_u8_t) { (uint8_t*)(arg1), (size_t)(arg2) };
+  extension_state_t ret = extension_hll_add_multi_int_bytes(arg, arg0, &arg3);
+  return ret;
+}
+__attribute__((export_name("hll-add-multi-int-bytes-emptyisnull")))
+int32_t __wasm_export_extension_hll_add_multi_int_bytes_emptyisnull(int32_t arg, int64_t arg0, int32_t arg1, int32_t arg2) {
+  extension_list_u8_t arg3 = (extension_list_u8_t) { (uint8_t*)(arg1), (size_t)(arg2) };
+  extension_state_t ret = extension_hll_add_multi_int_bytes_emptyisnull(arg, arg0, &arg3);
+  return ret;
+}
+__attribute__((export_name("hll-add-budgeted")))
+int32_t __wasm_export_extension_hll_add_budgeted(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2, int64_t arg3) {
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg0), (size_t)(arg1) };
+  extension_state_t ret = extension_hll_add_budgeted(arg, &arg4, arg2, arg3);
+  return ret;
+}
+__attribute__((export_name("hll-add-budgeted-emptyisnull")))
+int32_t __wasm_export_extension_hll_add_budgeted_emptyisnull(int32_t arg, int32_t arg0, int32_t arg1, int32_t arg2, int64_t arg3) {
+  extension_list_u8_t arg4 = (extension_list_u8_t) { (uint8_t*)(arg0), (size_t)(arg1) };
+  extension_state_t ret = extension_hll_add_budgeted_emptyisnull(arg, &arg4, arg2, arg3);
+  return ret;
+}
+__attribute__((export_name("hll-degraded-states")))
+int64_t __wasm_export_extension_hll_degraded_states(void) {
+  uint64_t ret = extension_hll_degraded_states();
+  return (int64_t) (ret);
+}
+__attribute__((export_name("hll-debug-counters")))
+int32_t __wasm_export_extension_hll_debug_counters(void) {
+  extension_string_t ret;
+  extension_hll_debug_counters(&ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-reset-debug-counters")))
+int32_t __wasm_export_extension_hll_reset_debug_counters(void) {
+  extension_string_t ret;
+  extension_hll_reset_debug_counters(&ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
 __attribute__((export_name("hll-add-hash")))
 int32_t __wasm_export_extension_hll_add_hash(int32_t arg, int64_t arg0) {
   extension_state_t ret = extension_hll_add_hash(arg, (uint64_t) (arg0));
@@ -156,6 +405,11 @@ int32_t __wasm_export_extension_hll_union_merge(int32_t arg, int32_t arg0) {
   extension_state_t ret = extension_hll_union_merge(arg, arg0);
   return ret;
 }
+__attribute__((export_name("hll-count")))
+int64_t __wasm_export_extension_hll_count(int32_t arg) {
+  int64_t ret = extension_hll_count(arg);
+  return ret;
+}
 __attribute__((export_name("hll-serialize")))
 int32_t __wasm_export_extension_hll_serialize(int32_t arg) {
   extension_list_u8_t ret;
@@ -174,12 +428,36 @@ int32_t __wasm_export_extension_hll_serialize_compact(int32_t arg) {
   *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
   return ptr;
 }
+__attribute__((export_name("hll-serialize-cached")))
+int32_t __wasm_export_extension_hll_serialize_cached(int32_t arg) {
+  extension_list_u8_t ret;
+  extension_hll_serialize_cached(arg, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
 __attribute__((export_name("hll-deserialize")))
 int32_t __wasm_export_extension_hll_deserialize(int32_t arg, int32_t arg0) {
   extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
   extension_state_t ret = extension_hll_deserialize(&arg1);
   return ret;
 }
+__attribute__((export_name("hll-serialize-state")))
+int32_t __wasm_export_extension_hll_serialize_state(int32_t arg) {
+  extension_list_u8_t ret;
+  extension_hll_serialize_state(arg, &ret);
+  int32_t ptr = (int32_t) &RET_AREA;
+  *((int32_t*)(ptr + 4)) = (int32_t) (ret).len;
+  *((int32_t*)(ptr + 0)) = (int32_t) (ret).ptr;
+  return ptr;
+}
+__attribute__((export_name("hll-deserialize-state")))
+int32_t __wasm_export_extension_hll_deserialize_state(int32_t arg, int32_t arg0) {
+  extension_list_u8_t arg1 = (extension_list_u8_t) { (uint8_t*)(arg), (size_t)(arg0) };
+  extension_state_t ret = extension_hll_deserialize_state(&arg1);
+  return ret;
+}
 __attribute__((export_name("hll-to-dense")))
 int32_t __wasm_export_extension_hll_to_dense(int32_t arg) {
   extension_state_t ret = extension_hll_to_dense(arg);
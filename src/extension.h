@@ -26,21 +26,56 @@ extern "C"
   double extension_hll_cardinality_emptyisnull(extension_list_u8_t *data);
   void extension_hll_union(extension_list_u8_t *left, extension_list_u8_t *right, extension_list_u8_t *ret0);
   void extension_hll_union_emptyisnull(extension_list_u8_t *left, extension_list_u8_t *right, extension_list_u8_t *ret0);
+  void extension_hll_delta(extension_list_u8_t *base, extension_list_u8_t *newer, extension_list_u8_t *ret0);
+  void extension_hll_delta_emptyisnull(extension_list_u8_t *base, extension_list_u8_t *newer, extension_list_u8_t *ret0);
+  void extension_hll_apply_delta(extension_list_u8_t *base, extension_list_u8_t *delta, extension_list_u8_t *ret0);
+  void extension_hll_apply_delta_emptyisnull(extension_list_u8_t *base, extension_list_u8_t *delta, extension_list_u8_t *ret0);
+  extension_state_t extension_hll_add_multi2(extension_state_t state, extension_list_u8_t *a, extension_list_u8_t *b);
+  extension_state_t extension_hll_add_multi2_emptyisnull(extension_state_t state, extension_list_u8_t *a, extension_list_u8_t *b);
+  extension_state_t extension_hll_add_multi3(extension_state_t state, extension_list_u8_t *a, extension_list_u8_t *b, extension_list_u8_t *c);
+  extension_state_t extension_hll_add_multi3_emptyisnull(extension_state_t state, extension_list_u8_t *a, extension_list_u8_t *b, extension_list_u8_t *c);
+  extension_state_t extension_hll_add_multi2_int(extension_state_t state, int64_t a, int64_t b);
+  extension_state_t extension_hll_add_multi2_int_emptyisnull(extension_state_t state, int64_t a, int64_t b);
+  extension_state_t extension_hll_add_multi3_int(extension_state_t state, int64_t a, int64_t b, int64_t c);
+  extension_state_t extension_hll_add_multi3_int_emptyisnull(extension_state_t state, int64_t a, int64_t b, int64_t c);
+  extension_state_t extension_hll_add_multi_int_bytes(extension_state_t state, int64_t a, extension_list_u8_t *b);
+  extension_state_t extension_hll_add_multi_int_bytes_emptyisnull(extension_state_t state, int64_t a, extension_list_u8_t *b);
+  extension_state_t extension_hll_add_budgeted(extension_state_t state, extension_list_u8_t *input, int32_t lg_k, int64_t budget_bytes);
+  extension_state_t extension_hll_add_budgeted_emptyisnull(extension_state_t state, extension_list_u8_t *input, int32_t lg_k, int64_t budget_bytes);
+  uint64_t extension_hll_degraded_states(void);
+  void extension_hll_debug_counters(extension_string_t *ret0);
+  void extension_hll_reset_debug_counters(extension_string_t *ret0);
   uint64_t extension_hll_hash(extension_list_u8_t *data);
   uint64_t extension_hll_hash_emptyisnull(extension_list_u8_t *data);
+  void extension_hll_cache(extension_list_u8_t *data, extension_list_u8_t *ret0);
+  void extension_hll_cache_emptyisnull(extension_list_u8_t *data, extension_list_u8_t *ret0);
+  void extension_hll_from_datasketches(extension_list_u8_t *data, extension_list_u8_t *ret0);
+  void extension_hll_from_datasketches_emptyisnull(extension_list_u8_t *data, extension_list_u8_t *ret0);
+  void extension_hll_to_datasketches(extension_list_u8_t *data, extension_string_t *hll_type, extension_list_u8_t *ret0);
+  void extension_hll_to_datasketches_emptyisnull(extension_list_u8_t *data, extension_string_t *hll_type, extension_list_u8_t *ret0);
   void extension_hll_print(extension_list_u8_t *data, extension_string_t *ret0);
   void extension_hll_print_emptyisnull(extension_list_u8_t *data, extension_string_t *ret0);
+  void extension_hll_stats(extension_list_u8_t *data, extension_string_t *ret0);
+  void extension_hll_stats_emptyisnull(extension_list_u8_t *data, extension_string_t *ret0);
   extension_state_t extension_hll_empty(void);
   extension_state_t extension_hll_add(extension_state_t state, extension_list_u8_t *input);
   extension_state_t extension_hll_add_emptyisnull(extension_state_t state, extension_list_u8_t *input);
+  extension_state_t extension_hll_add_split(extension_state_t state, extension_list_u8_t *input, extension_string_t *delimiter);
+  extension_state_t extension_hll_add_split_emptyisnull(extension_state_t state, extension_list_u8_t *input, extension_string_t *delimiter);
+  extension_state_t extension_hll_add_json_array(extension_state_t state, extension_string_t *input);
+  extension_state_t extension_hll_add_json_array_emptyisnull(extension_state_t state, extension_string_t *input);
   extension_state_t extension_hll_add_hash(extension_state_t state, uint64_t input);
   extension_state_t extension_hll_add_hash_emptyisnull(extension_state_t state, uint64_t input);
   extension_state_t extension_hll_union_agg(extension_state_t state, extension_list_u8_t *input);
   extension_state_t extension_hll_union_agg_emptyisnull(extension_state_t state, extension_list_u8_t *input);
   extension_state_t extension_hll_union_merge(extension_state_t left, extension_state_t right);
+  int64_t extension_hll_count(extension_state_t state);
   void extension_hll_serialize(extension_state_t state, extension_list_u8_t *ret0);
   void extension_hll_serialize_compact(extension_state_t state, extension_list_u8_t *ret0);
+  void extension_hll_serialize_cached(extension_state_t state, extension_list_u8_t *ret0);
   extension_state_t extension_hll_deserialize(extension_list_u8_t *data);
+  void extension_hll_serialize_state(extension_state_t state, extension_list_u8_t *ret0);
+  extension_state_t extension_hll_deserialize_state(extension_list_u8_t *data);
   extension_state_t extension_hll_to_dense(extension_state_t state);
   uint32_t extension_hll_is_dense(extension_state_t state);
   uint32_t extension_hll_is_sparse(extension_state_t state);
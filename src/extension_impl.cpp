@@ -1,577 +1,288 @@
 #include <cstdint>
+#include <cstring>
+#include <cstdlib>
 #include <cmath>
-#include <vector>
+#include <memory>
 #include <algorithm>
-#include <sstream>
-#include <cstring>
-#include <limits>
-#include <wasm_simd128.h>
+#include <string>
+#include <vector>
+#include <hll_sketch.h>
 #include <extension.h>
 
-const int DEFAULT_LG_K = 12;
-const int MIN_LG_K = 4;
-const int MAX_LG_K = 21;
-
-class Extension {
-private:
-    int lgK;
-    int k;
-    std::vector<uint8_t> buckets;
-    int64_t numNonZero;
-    bool isDenseMode;
-    bool valid;
-
-    static const int VALUE_BITS;
-    static const uint8_t PREAMBLE_INTS_BYTE;
-    static const uint8_t SER_VER_BYTE;
-    static const uint8_t FAMILY_BYTE;
-    static const uint8_t COMPACT_FLAG_MASK;
-    static const uint8_t FULL_SIZE_FLAG_MASK;
-
-    static const double invPow2Table[64];
-
-    static void packBits(const std::vector<uint8_t>& input, std::vector<uint8_t>& output,
-                         size_t startIdx, size_t numItems, int srcBits) {
-        int dstBitPos = 0;
-        size_t dstBytePos = startIdx;
-
-        uint32_t accumulator = 0;
-        int bitsInAccumulator = 0;
-
-        for (size_t i = 0; i < numItems; ++i) {
-            accumulator = (accumulator << srcBits) | (input[i] & ((1 << srcBits) - 1));
-            bitsInAccumulator += srcBits;
-
-            while (bitsInAccumulator >= 8) {
-                bitsInAccumulator -= 8;
-                output[dstBytePos++] = (accumulator >> bitsInAccumulator) & 0xFF;
-            }
-        }
-
-        if (bitsInAccumulator > 0) {
-            output[dstBytePos++] = (accumulator << (8 - bitsInAccumulator)) & 0xFF;
-        }
-    }
-
-    static void unpackBits(const std::vector<uint8_t>& input, std::vector<uint8_t>& output,
-                           size_t startIdx, size_t numItems, int dstBits) {
-        size_t srcBytePos = startIdx;
-        int bitsInAccumulator = 0;
-        uint32_t accumulator = 0;
-        int dstMask = (1 << dstBits) - 1;
-
-        for (size_t i = 0; i < numItems; ++i) {
-            while (bitsInAccumulator < dstBits) {
-                if (srcBytePos >= input.size()) {
-                    output.clear();
-                    return;
-                }
-                accumulator = (accumulator << 8) | input[srcBytePos++];
-                bitsInAccumulator += 8;
-            }
-            bitsInAccumulator -= dstBits;
-            output[i] = (accumulator >> bitsInAccumulator) & dstMask;
-        }
-    }
+using hll::SketchBase;
 
-    void couponUpdate(uint32_t coupon) {
-        int slotNo = coupon >> VALUE_BITS;
-        uint8_t newValue = coupon & ((1 << VALUE_BITS) - 1);
+namespace {
 
-        if (!isDenseMode) {
-            uint8_t& bucket = buckets[slotNo];
-            if (bucket < newValue) {
-                if (bucket == 0) {
-                    numNonZero++;
-                }
-                bucket = newValue;
-            }
-            if (numNonZero > k / 16) {
-                toDense();
-            }
-        } else {
-            if (buckets[slotNo] < newValue) {
-                buckets[slotNo] = newValue;
-            }
-        }
+uint64_t fieldHash(const extension_list_u8_t* field) {
+    if (field == nullptr || field->ptr == nullptr) {
+        return hll::hash(nullptr, 0);
     }
+    return hll::hash(field->ptr, field->len);
+}
 
-public:
-    Extension() : lgK(DEFAULT_LG_K),
-                  k(1 << DEFAULT_LG_K),
-                  buckets(k, 0),
-                  numNonZero(0),
-                  isDenseMode(false),
-                  valid(true) {}
-
-    Extension(int lgK) : lgK(std::clamp(lgK, MIN_LG_K, MAX_LG_K)),
-                         k(1 << this->lgK),
-                         buckets(k, 0),
-                         numNonZero(0),
-                         isDenseMode(false),
-                         valid(true) {}
-
-    bool isValid() const { return valid; }
-
-    static uint64_t hash(const uint8_t* key, size_t len) {
-        const uint64_t m = 0xc6a4a7935bd1e995ULL;
-        const int r = 47;
-
-        uint64_t h = 0x8445d61a4e774912 ^ (len * m);
+uint64_t fieldHash(int64_t field) {
+    return hll::hashInt(static_cast<uint64_t>(field));
+}
 
-        const uint8_t* data = key;
-        const uint8_t* end = data + (len & ~7);
+// States of hll_add_agg_budget share one budget per module instance.
+hll::MemoryBudget stateBudget;
 
-        while (data != end) {
-            uint64_t k;
-            memcpy(&k, data, sizeof(uint64_t));
+// Budgeted states are never folded below this precision (about 6.5% error).
+constexpr int BUDGET_MIN_LG_K = 8;
 
-            k *= m;
-            k ^= k >> r;
-            k *= m;
-
-            h ^= k;
-            h *= m;
+// Merges two states of possibly different lgK, frees one and returns the
+// survivor. Aggregates start from hll_empty's DEFAULT_LG_K sketch, so an empty
+// state that was never folded simply gives way to the other side. Otherwise
+// the larger lgK is folded into the smaller one, flagged as reduced precision.
+SketchBase* mergeStates(SketchBase* left, SketchBase* right) {
+    if (right->isEmpty() && !right->isReducedPrecision()) {
+        delete right;
+        return left;
+    }
+    if (left->isEmpty() && !left->isReducedPrecision()) {
+        delete left;
+        return right;
+    }
+    if (left->lgK() > right->lgK()) {
+        std::swap(left, right);
+    }
+    if (left->lgK() != right->lgK()) {
+        left->markReducedPrecision();
+    }
+    left->merge(*right);
+    delete right;
+    return left;
+}
 
-            data += 8;
-        }
+// Prepares a union state for an input merged straight from its encoding at
+// lgK. An empty start state takes the input's lgK and a larger state is folded
+// down to it. A smaller state is flagged, since the input will be folded into it.
+SketchBase* stateForInput(SketchBase* state, int lgK) {
+    if (state != nullptr && state->isEmpty() && !state->isReducedPrecision() && state->lgK() != lgK) {
+        delete state;
+        state = nullptr;
+    }
+    if (state == nullptr) {
+        return hll::makeSketch(lgK).release();
+    }
+    if (lgK < state->lgK()) {
+        std::unique_ptr<SketchBase> folded = state->foldTo(lgK);
+        delete state;
+        return folded.release();
+    }
+    if (lgK > state->lgK()) {
+        state->markReducedPrecision();
+    }
+    return state;
+}
 
-        switch (len & 7) {
-        case 7: h ^= uint64_t(data[6]) << 48;
-        case 6: h ^= uint64_t(data[5]) << 40;
-        case 5: h ^= uint64_t(data[4]) << 32;
-        case 4: h ^= uint64_t(data[3]) << 24;
-        case 3: h ^= uint64_t(data[2]) << 16;
-        case 2: h ^= uint64_t(data[1]) << 8;
-        case 1: h ^= uint64_t(data[0]);
-                h *= m;
-        };
+// Heap bytes of a dense state at lgK: the registers and their histogram.
+size_t denseStateBytes(int lgK) {
+    return (size_t(1) << lgK) + hll::HISTOGRAM_SIZE * sizeof(uint32_t);
+}
 
-        h ^= h >> r;
-        h *= m;
-        h ^= h >> r;
+// Folds a state that just turned dense with the budget over its limit to the
+// largest lgK that fits the room the other states leave, or to
+// BUDGET_MIN_LG_K if nothing does.
+SketchBase* degradeState(SketchBase* sketch) {
+    size_t others = stateBudget.used - std::min(stateBudget.used, sketch->memoryUsage());
+    int lgK = sketch->lgK() - 1;
+    while (lgK > BUDGET_MIN_LG_K && others + denseStateBytes(lgK) > stateBudget.limit) {
+        lgK--;
+    }
+    if (!sketch->isReducedPrecision()) {
+        stateBudget.degradedStates++;
+    }
+    std::unique_ptr<SketchBase> folded = sketch->foldTo(lgK);
+    delete sketch;
+    folded->attachBudget(&stateBudget);
+    return folded.release();
+}
 
-        return h;
+extension_state_t addKeyHash(extension_state_t state, uint64_t keyHash) {
+    SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+    if (sketch == nullptr) {
+        sketch = hll::makeSketch().release();
     }
+    sketch->updateWithHash(keyHash);
+    return reinterpret_cast<extension_state_t>(sketch);
+}
 
-    void updateWithHash(uint64_t hashValue) {
-        int slotNo = hashValue >> (64 - lgK);
-        uint64_t w = hashValue << lgK;
-        int rank = std::min(static_cast<int>(__builtin_clzll(w) + 1), 64 - lgK + 1);
+} // namespace
 
-        uint32_t coupon = (slotNo << VALUE_BITS) | rank;
-        couponUpdate(coupon);
+extern "C" {
+    extension_state_t extension_hll_empty() {
+        return reinterpret_cast<extension_state_t>(hll::makeSketch().release());
     }
 
-    void update(const uint8_t* key, size_t len) {
-        if (key == nullptr || len == 0) {
-            return;
+    void extension_hll_free(extension_state_t state) {
+        if (state != 0) {
+            SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+            delete sketch;
         }
-        updateWithHash(hash(key, len));
     }
 
-    void toDense() {
-        if (!isDenseMode) {
-            isDenseMode = true;
-            numNonZero = std::count_if(buckets.begin(), buckets.end(), [](uint8_t val) { return val != 0; });
+    extension_state_t extension_hll_add(extension_state_t state, extension_list_u8_t* input) {
+        if (input == nullptr || input->len == 0 || input->ptr == nullptr) {
+            return state;
         }
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        if (sketch == nullptr) {
+            sketch = hll::makeSketch().release();
+        }
+        sketch->update(input->ptr, input->len);
+        return reinterpret_cast<extension_state_t>(sketch);
     }
 
-    double estimate() const {
-        double sum = 0.0;
-        int zeros = 0;
-        int i = 0;
-        const int vectorSize = 16;
-        int limit = k - (k % vectorSize);
-        const uint8_t* bucketPtr = buckets.data();
-
-        for (; i < limit; i += vectorSize) {
-            v128_t vals = wasm_v128_load(&bucketPtr[i]);
-
-            v128_t zero_vec = wasm_i8x16_splat(0);
-            v128_t cmp_result = wasm_i8x16_eq(vals, zero_vec);
-
-            uint16_t mask = wasm_i8x16_bitmask(cmp_result);
-            zeros += __builtin_popcount(mask);
-
-            uint8_t valArray[vectorSize];
-            wasm_v128_store(valArray, vals);
-
-            for (int j = 0; j < vectorSize; ++j) {
-                uint8_t val = valArray[j];
-                sum += invPow2Table[val];
-            }
-        }
+    extension_state_t extension_hll_add_emptyisnull(extension_state_t state, extension_list_u8_t* input) {
+        return extension_hll_add(state, input);
+    }
 
-        for (; i < k; ++i) {
-            uint8_t val = bucketPtr[i];
-            if (val == 0) {
-                zeros++;
-            }
-            sum += invPow2Table[val];
+    extension_state_t extension_hll_add_split(extension_state_t state, extension_list_u8_t* input, extension_string_t* delimiter) {
+        if (input == nullptr || input->len == 0 || input->ptr == nullptr) {
+            return state;
         }
-
-        double estimate_value;
-        double alpha;
-        switch (k) {
-            case 16: alpha = 0.673; break;
-            case 32: alpha = 0.697; break;
-            case 64: alpha = 0.709; break;
-            default: alpha = 0.7213 / (1.0 + 1.079 / k); break;
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        if (sketch == nullptr) {
+            sketch = hll::makeSketch().release();
         }
-        estimate_value = alpha * k * k / sum;
-
-        if (estimate_value <= 2.5 * k) {
-            if (zeros != 0) {
-                estimate_value = k * log(static_cast<double>(k) / zeros);
-            }
-        } else if (estimate_value > (1.0 / 30.0) * (1ULL << 32)) {
-            estimate_value = -(1ULL << 32) * log(1.0 - (estimate_value / (1ULL << 32)));
+        const uint8_t* delimiterPtr = nullptr;
+        size_t delimiterLen = 0;
+        if (delimiter != nullptr && delimiter->ptr != nullptr) {
+            delimiterPtr = reinterpret_cast<const uint8_t*>(delimiter->ptr);
+            delimiterLen = delimiter->len;
         }
-
-        return estimate_value;
+        sketch->updateDelimited(input->ptr, input->len, delimiterPtr, delimiterLen);
+        return reinterpret_cast<extension_state_t>(sketch);
     }
 
-    static void writeVarInt(std::vector<uint8_t>& buffer, uint32_t value) {
-        while (value >= 0x80) {
-            buffer.push_back(static_cast<uint8_t>((value & 0x7F) | 0x80));
-            value >>= 7;
-        }
-        buffer.push_back(static_cast<uint8_t>(value & 0x7F));
+    extension_state_t extension_hll_add_split_emptyisnull(extension_state_t state, extension_list_u8_t* input, extension_string_t* delimiter) {
+        return extension_hll_add_split(state, input, delimiter);
     }
 
-    static bool readVarInt(const std::vector<uint8_t>& data, size_t& offset, uint32_t& value) {
-        value = 0;
-        int shift = 0;
-        while (offset < data.size()) {
-            uint8_t byte = data[offset++];
-            value |= (uint32_t)(byte & 0x7F) << shift;
-            if ((byte & 0x80) == 0) return true;
-            shift += 7;
-            if (shift > 28) {
-                return false;
-            }
+    extension_state_t extension_hll_add_json_array(extension_state_t state, extension_string_t* input) {
+        if (input == nullptr || input->len == 0 || input->ptr == nullptr) {
+            return state;
         }
-        return false;
-    }
-
-    std::vector<uint8_t> serialize() const {
-        std::vector<uint8_t> result;
-        result.reserve(isDenseMode ? 5 + k : 5 + 3 * numNonZero);
-
-        result.push_back(PREAMBLE_INTS_BYTE);
-        result.push_back(SER_VER_BYTE);
-        result.push_back(FAMILY_BYTE);
-
-        uint8_t flags = 0;
-        if (isDenseMode) flags |= FULL_SIZE_FLAG_MASK;
-        result.push_back(flags);
-
-        result.push_back(static_cast<uint8_t>(lgK));
-
-        if (!isDenseMode) {
-            writeVarInt(result, static_cast<uint32_t>(numNonZero));
-
-            for (int i = 0; i < k; ++i) {
-                if (buckets[i] != 0) {
-                    writeVarInt(result, static_cast<uint32_t>(i));
-                    result.push_back(buckets[i]);
-                }
-            }
-        } else {
-            result.insert(result.end(), buckets.begin(), buckets.end());
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        if (sketch == nullptr) {
+            sketch = hll::makeSketch().release();
         }
-        return result;
+        sketch->updateJsonArray(input->ptr, input->len);
+        return reinterpret_cast<extension_state_t>(sketch);
     }
 
-    std::vector<uint8_t> serialize_compact() const {
-        std::vector<uint8_t> result;
-        result.reserve(8);
-
-        result.push_back(PREAMBLE_INTS_BYTE);
-        result.push_back(SER_VER_BYTE);
-        result.push_back(FAMILY_BYTE);
-
-        uint8_t flags = 0;
-        if (isDenseMode) flags |= FULL_SIZE_FLAG_MASK;
-        flags |= COMPACT_FLAG_MASK;
-        result.push_back(flags);
-
-        result.push_back(static_cast<uint8_t>(lgK));
-
-        if (!isDenseMode) {
-            writeVarInt(result, static_cast<uint32_t>(numNonZero));
-
-            std::vector<uint32_t> pairs;
-            for (int i = 0; i < k; ++i) {
-                if (buckets[i] != 0) {
-                    uint32_t pair = (static_cast<uint32_t>(i) << VALUE_BITS) | buckets[i];
-                    pairs.push_back(pair);
-                }
-            }
-
-            std::sort(pairs.begin(), pairs.end());
-
-            for (uint32_t pair : pairs) {
-                writeVarInt(result, pair);
-            }
-        } else {
-            size_t numBytes = (k * VALUE_BITS + 7) / 8;
-            size_t currentSize = result.size();
-            result.resize(currentSize + numBytes, 0);
-
-            packBits(buckets, result, currentSize, k, VALUE_BITS);
-        }
-
-        return result;
+    extension_state_t extension_hll_add_json_array_emptyisnull(extension_state_t state, extension_string_t* input) {
+        return extension_hll_add_json_array(state, input);
     }
 
-    static Extension deserialize(const std::vector<uint8_t>& data) {
-        Extension hll;
-        if (data.size() < 5) {
-            hll.valid = false;
-            return hll;
+    extension_state_t extension_hll_add_hash(extension_state_t state, uint64_t input) {
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        if (sketch == nullptr) {
+            sketch = hll::makeSketch().release();
         }
+        sketch->updateWithHash(input);
+        return reinterpret_cast<extension_state_t>(sketch);
+    }
 
-        size_t offset = 0;
-
-        uint8_t preambleInts = data[offset++];
-        uint8_t serVer = data[offset++];
-        uint8_t family = data[offset++];
-        uint8_t flags = data[offset++];
-        int lgK = data[offset++];
-
-        if (preambleInts != PREAMBLE_INTS_BYTE || serVer != SER_VER_BYTE ||
-            family != FAMILY_BYTE || lgK < MIN_LG_K || lgK > MAX_LG_K) {
-            hll.valid = false;
-            return hll;
-        }
+    extension_state_t extension_hll_add_hash_emptyisnull(extension_state_t state, uint64_t input) {
+        return extension_hll_add_hash(state, input);
+    }
 
-        bool isDenseMode = (flags & FULL_SIZE_FLAG_MASK) != 0;
-        bool isCompact = (flags & COMPACT_FLAG_MASK) != 0;
+    extension_state_t extension_hll_add_multi2(extension_state_t state, extension_list_u8_t* a, extension_list_u8_t* b) {
+        return addKeyHash(state, hll::combineHashes({fieldHash(a), fieldHash(b)}));
+    }
 
-        hll.lgK = lgK;
-        hll.k = 1 << lgK;
-        hll.isDenseMode = isDenseMode;
-        hll.buckets.resize(hll.k, 0);
+    extension_state_t extension_hll_add_multi2_emptyisnull(extension_state_t state, extension_list_u8_t* a, extension_list_u8_t* b) {
+        return extension_hll_add_multi2(state, a, b);
+    }
 
-        if (!isDenseMode) {
-            uint32_t numNonZero;
-            if (!readVarInt(data, offset, numNonZero)) {
-                hll.valid = false;
-                return hll;
-            }
-            hll.numNonZero = numNonZero;
-
-            if (isCompact) {
-                for (uint32_t i = 0; i < numNonZero; ++i) {
-                    uint32_t pair;
-                    if (!readVarInt(data, offset, pair)) {
-                        hll.valid = false;
-                        return hll;
-                    }
-                    uint32_t index = pair >> VALUE_BITS;
-                    uint8_t value = pair & ((1 << VALUE_BITS) - 1);
-
-                    if (index >= hll.k) {
-                        hll.valid = false;
-                        return hll;
-                    }
-                    hll.buckets[index] = value;
-                }
-            } else {
-                while (offset < data.size()) {
-                    uint32_t index;
-                    if (!readVarInt(data, offset, index)) {
-                        hll.valid = false;
-                        return hll;
-                    }
-
-                    if (offset >= data.size()) {
-                        hll.valid = false;
-                        return hll;
-                    }
-
-                    uint8_t value = data[offset++];
-
-                    if (index >= hll.k) {
-                        hll.valid = false;
-                        return hll;
-                    }
-
-                    hll.buckets[index] = value;
-                }
-            }
-        } else {
-            if (isCompact) {
-                unpackBits(data, hll.buckets, offset, hll.k, VALUE_BITS);
-            } else {
-                if (data.size() != offset + hll.k) {
-                    hll.valid = false;
-                    return hll;
-                }
-                hll.buckets.assign(data.begin() + offset, data.end());
-            }
-        }
+    extension_state_t extension_hll_add_multi3(extension_state_t state, extension_list_u8_t* a, extension_list_u8_t* b, extension_list_u8_t* c) {
+        return addKeyHash(state, hll::combineHashes({fieldHash(a), fieldHash(b), fieldHash(c)}));
+    }
 
-        hll.valid = true;
-        return hll;
+    extension_state_t extension_hll_add_multi3_emptyisnull(extension_state_t state, extension_list_u8_t* a, extension_list_u8_t* b, extension_list_u8_t* c) {
+        return extension_hll_add_multi3(state, a, b, c);
     }
 
-    void merge(const Extension& other) {
-        if (!other.valid) return;
+    extension_state_t extension_hll_add_multi2_int(extension_state_t state, int64_t a, int64_t b) {
+        return addKeyHash(state, hll::combineHashes({fieldHash(a), fieldHash(b)}));
+    }
 
-        if (lgK != other.lgK) return;
+    extension_state_t extension_hll_add_multi2_int_emptyisnull(extension_state_t state, int64_t a, int64_t b) {
+        return extension_hll_add_multi2_int(state, a, b);
+    }
 
-        if (!isDenseMode && !other.isDenseMode) {
-            for (int i = 0; i < k; i++) {
-                if (other.buckets[i] > buckets[i]) {
-                    couponUpdate((i << VALUE_BITS) | other.buckets[i]);
-                }
-            }
-        } else {
-            if (!isDenseMode) toDense();
-            for (int i = 0; i < k; i++) {
-                uint8_t newValue = std::max(buckets[i], other.buckets[i]);
-                if (newValue > buckets[i]) {
-                    couponUpdate((i << VALUE_BITS) | newValue);
-                }
-            }
-        }
+    extension_state_t extension_hll_add_multi3_int(extension_state_t state, int64_t a, int64_t b, int64_t c) {
+        return addKeyHash(state, hll::combineHashes({fieldHash(a), fieldHash(b), fieldHash(c)}));
     }
 
-    std::string toString() const {
-        std::ostringstream oss;
-        oss << "HyperLogLog Sketch:\n  LgK: " << lgK << "\n  K: " << k
-            << "\n  Mode: " << (isDenseMode ? "Dense" : "Sparse")
-            << "\n  Estimated cardinality: " << std::llround(estimate());
-        return oss.str();
-    }
-
-    bool isSparse() const { return !isDenseMode; }
-    bool isDense() const { return isDenseMode; }
-};
-
-const int Extension::VALUE_BITS = 7;
-const uint8_t Extension::PREAMBLE_INTS_BYTE = 8;
-const uint8_t Extension::SER_VER_BYTE = 1;
-const uint8_t Extension::FAMILY_BYTE = 1;
-const uint8_t Extension::COMPACT_FLAG_MASK = 8;
-const uint8_t Extension::FULL_SIZE_FLAG_MASK = 32;
-
-const double Extension::invPow2Table[64] = {
-    1.0,
-    0.5,
-    0.25,
-    0.125,
-    0.0625,
-    0.03125,
-    0.015625,
-    0.0078125,
-    0.00390625,
-    0.001953125,
-    0.0009765625,
-    0.00048828125,
-    0.000244140625,
-    0.0001220703125,
-    6.103515625e-05,
-    3.0517578125e-05,
-    1.52587890625e-05,
-    7.62939453125e-06,
-    3.814697265625e-06,
-    1.9073486328125e-06,
-    9.5367431640625e-07,
-    4.76837158203125e-07,
-    2.384185791015625e-07,
-    1.1920928955078125e-07,
-    5.960464477539063e-08,
-    2.980232238769531e-08,
-    1.490116119384766e-08,
-    7.450580596923828e-09,
-    3.725290298461914e-09,
-    1.862645149230957e-09,
-    9.313225746154785e-10,
-    4.656612873077393e-10,
-    2.328306436538696e-10,
-    1.164153218269348e-10,
-    5.820766091346741e-11,
-    2.910383045673370e-11,
-    1.455191522836685e-11,
-    7.275957614183426e-12,
-    3.637978807091713e-12,
-    1.818989403545857e-12,
-    9.094947017729282e-13,
-    4.547473508864641e-13,
-    2.2737367544323206e-13,
-    1.1368683772161603e-13,
-    5.684341886080802e-14,
-    2.842170943040401e-14,
-    1.4210854715202004e-14,
-    7.105427357601002e-15,
-    3.552713678800501e-15,
-    1.7763568394002505e-15,
-    8.881784197001252e-16,
-    4.440892098500626e-16,
-    2.220446049250313e-16,
-    1.1102230246251565e-16,
-    5.551115123125783e-17,
-    2.7755575615628914e-17,
-    1.3877787807814457e-17,
-    6.938893903907228e-18,
-    3.469446951953614e-18,
-    1.734723475976807e-18,
-    8.673617379884035e-19,
-    4.336808689942018e-19,
-    2.168404344971009e-19,
-    1.0842021724855044e-19,
-};
+    extension_state_t extension_hll_add_multi3_int_emptyisnull(extension_state_t state, int64_t a, int64_t b, int64_t c) {
+        return extension_hll_add_multi3_int(state, a, b, c);
+    }
 
-extern "C" {
-    extension_state_t extension_hll_empty() {
-        return reinterpret_cast<extension_state_t>(new Extension());
+    extension_state_t extension_hll_add_multi_int_bytes(extension_state_t state, int64_t a, extension_list_u8_t* b) {
+        return addKeyHash(state, hll::combineHashes({fieldHash(a), fieldHash(b)}));
     }
 
-    void extension_hll_free(extension_state_t state) {
-        if (state != 0) {
-            Extension* hll = reinterpret_cast<Extension*>(state);
-            delete hll;
-        }
+    extension_state_t extension_hll_add_multi_int_bytes_emptyisnull(extension_state_t state, int64_t a, extension_list_u8_t* b) {
+        return extension_hll_add_multi_int_bytes(state, a, b);
     }
 
-    extension_state_t extension_hll_add(extension_state_t state, extension_list_u8_t* input) {
+    extension_state_t extension_hll_add_budgeted(extension_state_t state, extension_list_u8_t* input, int32_t lg_k, int64_t budget_bytes) {
         if (input == nullptr || input->len == 0 || input->ptr == nullptr) {
             return state;
         }
-        Extension* hll = reinterpret_cast<Extension*>(state);
-        if (hll == nullptr) {
-            hll = new Extension();
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        int lgK = std::clamp(static_cast<int>(lg_k), hll::MIN_LG_K, hll::MAX_LG_K);
+        if (sketch == nullptr || (sketch->lgK() != lgK && sketch->isEmpty() && !sketch->isReducedPrecision())) {
+            delete sketch;
+            sketch = hll::makeSketch(lgK).release();
+        }
+        // The limit is taken from the first row while no budgeted state is
+        // alive, so one query's states all share the same limit.
+        if (stateBudget.used == 0) {
+            stateBudget.limit = budget_bytes > 0 ? static_cast<size_t>(budget_bytes) : 0;
         }
-        hll->update(input->ptr, input->len);
-        return reinterpret_cast<extension_state_t>(hll);
+        sketch->attachBudget(&stateBudget);
+
+        // Only the sparse-to-dense promotion can blow the budget; groups that
+        // are dense already keep their precision.
+        bool wasDense = sketch->isDense();
+        sketch->update(input->ptr, input->len);
+        if (!wasDense && sketch->isDense() && stateBudget.overLimit() && sketch->lgK() > BUDGET_MIN_LG_K) {
+            sketch = degradeState(sketch);
+        }
+        return reinterpret_cast<extension_state_t>(sketch);
     }
 
-    extension_state_t extension_hll_add_emptyisnull(extension_state_t state, extension_list_u8_t* input) {
-        return extension_hll_add(state, input);
+    extension_state_t extension_hll_add_budgeted_emptyisnull(extension_state_t state, extension_list_u8_t* input, int32_t lg_k, int64_t budget_bytes) {
+        return extension_hll_add_budgeted(state, input, lg_k, budget_bytes);
     }
 
-    extension_state_t extension_hll_add_hash(extension_state_t state, uint64_t input) {
-        Extension* hll = reinterpret_cast<Extension*>(state);
-        if (hll == nullptr) {
-            hll = new Extension();
-        }
-        hll->updateWithHash(input);
-        return reinterpret_cast<extension_state_t>(hll);
+    uint64_t extension_hll_degraded_states() {
+        return stateBudget.degradedStates;
     }
 
-    extension_state_t extension_hll_add_hash_emptyisnull(extension_state_t state, uint64_t input) {
-        return extension_hll_add_hash(state, input);
+    void extension_hll_debug_counters(extension_string_t* ret0) {
+        std::string json = hll::debugCountersJson();
+        ret0->ptr = (char*)malloc(json.size() + 1);
+        ret0->len = json.size();
+        memcpy(ret0->ptr, json.c_str(), json.size() + 1);
+    }
+
+    void extension_hll_reset_debug_counters(extension_string_t* ret0) {
+        std::string json = hll::debugCountersJson(true);
+        ret0->ptr = (char*)malloc(json.size() + 1);
+        ret0->len = json.size();
+        memcpy(ret0->ptr, json.c_str(), json.size() + 1);
     }
 
     uint64_t extension_hll_hash(extension_list_u8_t* data) {
         if (data == nullptr || data->len == 0 || data->ptr == nullptr) {
             return 0;
         }
-        return Extension::hash(data->ptr, data->len);
+        return hll::hash(data->ptr, data->len);
     }
 
     uint64_t extension_hll_hash_emptyisnull(extension_list_u8_t* data) {
@@ -580,29 +291,27 @@ extern "C" {
 
     extension_state_t extension_hll_union_merge(extension_state_t left, extension_state_t right) {
         if (left == 0 && right == 0) {
-            Extension* new_hll = new Extension();
+            SketchBase* new_hll = hll::makeSketch().release();
             return reinterpret_cast<extension_state_t>(new_hll);
         } else if (left == 0) {
             return right;
         } else if (right == 0) {
             return left;
         } else {
-            Extension* hll_left = reinterpret_cast<Extension*>(left);
-            Extension* hll_right = reinterpret_cast<Extension*>(right);
+            SketchBase* hll_left = reinterpret_cast<SketchBase*>(left);
+            SketchBase* hll_right = reinterpret_cast<SketchBase*>(right);
 
-            hll_left->merge(*hll_right);
-            delete hll_right;
-            return left;
+            return reinterpret_cast<extension_state_t>(mergeStates(hll_left, hll_right));
         }
     }
 
     extension_state_t extension_hll_to_dense(extension_state_t state) {
         if (state == 0) {
-            return reinterpret_cast<extension_state_t>(new Extension());
+            return reinterpret_cast<extension_state_t>(hll::makeSketch().release());
         }
-        Extension* hll = reinterpret_cast<Extension*>(state);
-        if (hll->isSparse()) {
-            hll->toDense();
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        if (sketch->isSparse()) {
+            sketch->toDense();
         }
         return state;
     }
@@ -611,12 +320,15 @@ extern "C" {
         if (data == nullptr || data->ptr == nullptr || data->len == 0) {
             return 0.0;
         }
-        std::vector<uint8_t> vec(data->ptr, data->ptr + data->len);
-        Extension hll = Extension::deserialize(vec);
-        if (!hll.isValid()) {
+        double cached;
+        if (hll::readCachedEstimate(data->ptr, data->len, cached)) {
+            return cached;
+        }
+        std::unique_ptr<SketchBase> sketch = hll::deserialize(data->ptr, data->len);
+        if (!sketch) {
             return 0.0;
         }
-        return hll.estimate();
+        return sketch->estimate();
     }
 
     double extension_hll_cardinality_emptyisnull(extension_list_u8_t* data) {
@@ -632,21 +344,18 @@ extern "C" {
             return;
         }
 
-        std::vector<uint8_t> vec_left(left->ptr, left->ptr + left->len);
-        std::vector<uint8_t> vec_right(right->ptr, right->ptr + right->len);
+        std::unique_ptr<SketchBase> hll_left = hll::deserialize(left->ptr, left->len);
+        std::unique_ptr<SketchBase> hll_right = hll::deserialize(right->ptr, right->len);
 
-        Extension hll_left = Extension::deserialize(vec_left);
-        Extension hll_right = Extension::deserialize(vec_right);
-
-        if (!hll_left.isValid() || !hll_right.isValid()) {
+        if (!hll_left || !hll_right) {
             ret0->ptr = nullptr;
             ret0->len = 0;
             return;
         }
 
-        hll_left.merge(hll_right);
+        std::unique_ptr<SketchBase> merged(mergeStates(hll_left.release(), hll_right.release()));
 
-        std::vector<uint8_t> result = hll_left.serialize();
+        std::vector<uint8_t> result = merged->serialize();
         ret0->ptr = (uint8_t*)malloc(result.size());
         ret0->len = result.size();
         memcpy(ret0->ptr, result.data(), result.size());
@@ -656,6 +365,64 @@ extern "C" {
         extension_hll_union(left, right, ret0);
     }
 
+    void extension_hll_delta(extension_list_u8_t* base, extension_list_u8_t* newer, extension_list_u8_t* ret0) {
+        if (base == nullptr || newer == nullptr || ret0 == nullptr) return;
+        ret0->ptr = nullptr;
+        ret0->len = 0;
+        if (base->ptr == nullptr || base->len == 0 || newer->ptr == nullptr || newer->len == 0) {
+            return;
+        }
+
+        hll::Header header;
+        size_t offset;
+        std::unique_ptr<SketchBase> hll_base = hll::deserialize(base->ptr, base->len);
+        std::unique_ptr<SketchBase> hll_newer = hll::deserialize(newer->ptr, newer->len);
+        if (!hll_base || !hll_newer || !hll::parseHeader(newer->ptr, newer->len, header, offset)) {
+            return;
+        }
+
+        uint8_t layout = 0;
+        if (header.isCompact) layout |= hll::COMPACT_FLAG_MASK;
+        if (header.isCached) layout |= hll::DELTA_CACHED_FLAG_MASK;
+        std::vector<uint8_t> result = hll::encodeDelta(*hll_base, *hll_newer, layout);
+        if (result.empty()) {
+            return;
+        }
+        ret0->ptr = (uint8_t*)malloc(result.size());
+        ret0->len = result.size();
+        memcpy(ret0->ptr, result.data(), result.size());
+    }
+
+    void extension_hll_delta_emptyisnull(extension_list_u8_t* base, extension_list_u8_t* newer, extension_list_u8_t* ret0) {
+        extension_hll_delta(base, newer, ret0);
+    }
+
+    void extension_hll_apply_delta(extension_list_u8_t* base, extension_list_u8_t* delta, extension_list_u8_t* ret0) {
+        if (base == nullptr || delta == nullptr || ret0 == nullptr) return;
+        ret0->ptr = nullptr;
+        ret0->len = 0;
+        if (base->ptr == nullptr || base->len == 0 || !hll::isDeltaBlob(delta->ptr, delta->len)) {
+            return;
+        }
+
+        std::unique_ptr<SketchBase> sketch = hll::deserialize(base->ptr, base->len);
+        if (!sketch || sketch->lgK() != delta->ptr[1] || !sketch->applyDelta(delta->ptr, delta->len)) {
+            return;
+        }
+
+        uint8_t layout = delta->ptr[2];
+        bool withCache = (layout & hll::DELTA_CACHED_FLAG_MASK) != 0;
+        std::vector<uint8_t> result = (layout & hll::COMPACT_FLAG_MASK) != 0 ? sketch->serialize_compact(withCache)
+                                                                             : sketch->serialize(withCache);
+        ret0->ptr = (uint8_t*)malloc(result.size());
+        ret0->len = result.size();
+        memcpy(ret0->ptr, result.data(), result.size());
+    }
+
+    void extension_hll_apply_delta_emptyisnull(extension_list_u8_t* base, extension_list_u8_t* delta, extension_list_u8_t* ret0) {
+        extension_hll_apply_delta(base, delta, ret0);
+    }
+
     void extension_hll_print(extension_list_u8_t* data, extension_string_t* ret0) {
         if (data == nullptr || data->ptr == nullptr || data->len == 0 || ret0 == nullptr) {
             if (ret0) {
@@ -665,16 +432,15 @@ extern "C" {
             return;
         }
 
-        std::vector<uint8_t> vec(data->ptr, data->ptr + data->len);
-        Extension hll = Extension::deserialize(vec);
+        std::unique_ptr<SketchBase> sketch = hll::deserialize(data->ptr, data->len);
 
-        if (!hll.isValid()) {
+        if (!sketch) {
             ret0->ptr = nullptr;
             ret0->len = 0;
             return;
         }
 
-        std::string result = hll.toString();
+        std::string result = sketch->toString();
         ret0->ptr = (char*)malloc(result.size() + 1);
         ret0->len = result.size();
         memcpy(ret0->ptr, result.c_str(), result.size() + 1);
@@ -684,22 +450,66 @@ extern "C" {
         extension_hll_print(data, ret0);
     }
 
+    void extension_hll_stats(extension_list_u8_t* data, extension_string_t* ret0) {
+        if (data == nullptr || data->ptr == nullptr || data->len == 0 || ret0 == nullptr) {
+            if (ret0) {
+                ret0->ptr = nullptr;
+                ret0->len = 0;
+            }
+            return;
+        }
+
+        hll::Stats stats;
+        if (!hll::scanStats(data->ptr, data->len, stats)) {
+            ret0->ptr = nullptr;
+            ret0->len = 0;
+            return;
+        }
+
+        std::string json = hll::formatStats(stats, data->len);
+        ret0->ptr = (char*)malloc(json.size() + 1);
+        ret0->len = json.size();
+        memcpy(ret0->ptr, json.c_str(), json.size() + 1);
+    }
+
+    void extension_hll_stats_emptyisnull(extension_list_u8_t* data, extension_string_t* ret0) {
+        extension_hll_stats(data, ret0);
+    }
+
     extension_state_t extension_hll_union_agg(extension_state_t state, extension_list_u8_t* input) {
         if (input == nullptr || input->ptr == nullptr || input->len == 0) {
             return state;
         }
-        Extension* hll_state = reinterpret_cast<Extension*>(state);
-        Extension hll_input = Extension::deserialize(
-            std::vector<uint8_t>(input->ptr, input->ptr + input->len));
-        if (!hll_input.isValid()) {
+        SketchBase* hll_state = reinterpret_cast<SketchBase*>(state);
+        if (hll::isDeltaBlob(input->ptr, input->len)) {
+            // Deltas carry absolute register values, so a base and all of its
+            // deltas union to the newest snapshot without rebuilding each one.
+            hll_state = stateForInput(hll_state, input->ptr[1]);
+            if (!hll_state->applyDelta(input->ptr, input->len)) {
+                HLL_COUNT(rejectedInputs, 1);
+            }
+            return reinterpret_cast<extension_state_t>(hll_state);
+        }
+        if (hll::isDataSketchesBlob(input->ptr, input->len)) {
+            int dsLgK = hll::dataSketchesLgK(input->ptr, input->len);
+            if (dsLgK < hll::MIN_LG_K || dsLgK > hll::MAX_LG_K) {
+                HLL_COUNT(rejectedInputs, 1);
+                return state;
+            }
+            hll_state = stateForInput(hll_state, dsLgK);
+            if (!hll_state->mergeDataSketches(input->ptr, input->len)) {
+                HLL_COUNT(rejectedInputs, 1);
+            }
+            return reinterpret_cast<extension_state_t>(hll_state);
+        }
+        std::unique_ptr<SketchBase> hll_input = hll::deserialize(input->ptr, input->len);
+        if (!hll_input) {
             return state;
         }
         if (hll_state == nullptr) {
-            hll_state = new Extension(hll_input);
-            return reinterpret_cast<extension_state_t>(hll_state);
+            return reinterpret_cast<extension_state_t>(hll_input.release());
         } else {
-            hll_state->merge(hll_input);
-            return state;
+            return reinterpret_cast<extension_state_t>(mergeStates(hll_state, hll_input.release()));
         }
     }
 
@@ -707,6 +517,14 @@ extern "C" {
         return extension_hll_union_agg(state, input);
     }
 
+    int64_t extension_hll_count(extension_state_t state) {
+        if (state == 0) {
+            return 0;
+        }
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        return std::llround(sketch->estimate());
+    }
+
     void extension_hll_serialize(extension_state_t state, extension_list_u8_t* ret0) {
         if (state == 0 || ret0 == nullptr) {
             if (ret0) {
@@ -715,8 +533,8 @@ extern "C" {
             }
             return;
         }
-        Extension* hll = reinterpret_cast<Extension*>(state);
-        std::vector<uint8_t> result = hll->serialize();
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        std::vector<uint8_t> result = sketch->serialize();
         ret0->ptr = (uint8_t*)malloc(result.size());
         ret0->len = result.size();
         memcpy(ret0->ptr, result.data(), result.size());
@@ -730,36 +548,172 @@ extern "C" {
             }
             return;
         }
-        Extension* hll = reinterpret_cast<Extension*>(state);
-        std::vector<uint8_t> result = hll->serialize_compact();
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        std::vector<uint8_t> result = sketch->serialize_compact();
+        ret0->ptr = (uint8_t*)malloc(result.size());
+        ret0->len = result.size();
+        memcpy(ret0->ptr, result.data(), result.size());
+    }
+
+    void extension_hll_serialize_cached(extension_state_t state, extension_list_u8_t* ret0) {
+        if (state == 0 || ret0 == nullptr) {
+            if (ret0) {
+                ret0->ptr = nullptr;
+                ret0->len = 0;
+            }
+            return;
+        }
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        std::vector<uint8_t> result = sketch->serialize(true);
         ret0->ptr = (uint8_t*)malloc(result.size());
         ret0->len = result.size();
         memcpy(ret0->ptr, result.data(), result.size());
     }
 
+    void extension_hll_cache(extension_list_u8_t* data, extension_list_u8_t* ret0) {
+        if (data == nullptr || data->ptr == nullptr || data->len == 0 || ret0 == nullptr) {
+            if (ret0) {
+                ret0->ptr = nullptr;
+                ret0->len = 0;
+            }
+            return;
+        }
+
+        std::unique_ptr<SketchBase> sketch = hll::deserialize(data->ptr, data->len);
+
+        if (!sketch) {
+            ret0->ptr = nullptr;
+            ret0->len = 0;
+            return;
+        }
+
+        std::vector<uint8_t> result = hll::isCompactEncoding(data->ptr, data->len)
+            ? sketch->serialize_compact(true)
+            : sketch->serialize(true);
+        ret0->ptr = (uint8_t*)malloc(result.size());
+        ret0->len = result.size();
+        memcpy(ret0->ptr, result.data(), result.size());
+    }
+
+    void extension_hll_cache_emptyisnull(extension_list_u8_t* data, extension_list_u8_t* ret0) {
+        extension_hll_cache(data, ret0);
+    }
+
+    void extension_hll_from_datasketches(extension_list_u8_t* data, extension_list_u8_t* ret0) {
+        if (data == nullptr || data->ptr == nullptr || data->len == 0 || ret0 == nullptr) {
+            if (ret0) {
+                ret0->ptr = nullptr;
+                ret0->len = 0;
+            }
+            return;
+        }
+
+        std::unique_ptr<SketchBase> sketch = hll::makeSketch(hll::dataSketchesLgK(data->ptr, data->len));
+        if (!sketch->mergeDataSketches(data->ptr, data->len)) {
+            ret0->ptr = nullptr;
+            ret0->len = 0;
+            return;
+        }
+
+        std::vector<uint8_t> result = sketch->serialize();
+        ret0->ptr = (uint8_t*)malloc(result.size());
+        ret0->len = result.size();
+        memcpy(ret0->ptr, result.data(), result.size());
+    }
+
+    void extension_hll_from_datasketches_emptyisnull(extension_list_u8_t* data, extension_list_u8_t* ret0) {
+        extension_hll_from_datasketches(data, ret0);
+    }
+
+    void extension_hll_to_datasketches(extension_list_u8_t* data, extension_string_t* hll_type, extension_list_u8_t* ret0) {
+        if (data == nullptr || data->ptr == nullptr || data->len == 0 ||
+            hll_type == nullptr || hll_type->ptr == nullptr || ret0 == nullptr) {
+            if (ret0) {
+                ret0->ptr = nullptr;
+                ret0->len = 0;
+            }
+            return;
+        }
+
+        std::string type(hll_type->ptr, hll_type->len);
+        int tgtHllType;
+        if (type == "HLL_4") {
+            tgtHllType = 0;
+        } else if (type == "HLL_6") {
+            tgtHllType = 1;
+        } else if (type == "HLL_8") {
+            tgtHllType = 2;
+        } else {
+            ret0->ptr = nullptr;
+            ret0->len = 0;
+            return;
+        }
+
+        std::unique_ptr<SketchBase> sketch = hll::deserialize(data->ptr, data->len);
+
+        if (!sketch) {
+            ret0->ptr = nullptr;
+            ret0->len = 0;
+            return;
+        }
+
+        std::vector<uint8_t> result = sketch->serialize_datasketches(tgtHllType);
+        ret0->ptr = (uint8_t*)malloc(result.size());
+        ret0->len = result.size();
+        memcpy(ret0->ptr, result.data(), result.size());
+    }
+
+    void extension_hll_to_datasketches_emptyisnull(extension_list_u8_t* data, extension_string_t* hll_type, extension_list_u8_t* ret0) {
+        extension_hll_to_datasketches(data, hll_type, ret0);
+    }
+
     extension_state_t extension_hll_deserialize(extension_list_u8_t* data) {
         if (data == nullptr || data->ptr == nullptr || data->len == 0) {
             return 0;
         }
-        std::vector<uint8_t> vec(data->ptr, data->ptr + data->len);
-        Extension hll = Extension::deserialize(vec);
-        if (!hll.isValid()) {
+        std::unique_ptr<SketchBase> sketch = hll::deserialize(data->ptr, data->len);
+        if (!sketch) {
+            return 0;
+        }
+        return reinterpret_cast<extension_state_t>(sketch.release());
+    }
+
+    void extension_hll_serialize_state(extension_state_t state, extension_list_u8_t* ret0) {
+        if (state == 0 || ret0 == nullptr) {
+            if (ret0) {
+                ret0->ptr = nullptr;
+                ret0->len = 0;
+            }
+            return;
+        }
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        std::vector<uint8_t> result = sketch->serializeState();
+        ret0->ptr = (uint8_t*)malloc(result.size());
+        ret0->len = result.size();
+        memcpy(ret0->ptr, result.data(), result.size());
+    }
+
+    extension_state_t extension_hll_deserialize_state(extension_list_u8_t* data) {
+        if (data == nullptr || data->ptr == nullptr || data->len == 0) {
+            return 0;
+        }
+        std::unique_ptr<SketchBase> sketch = hll::deserializeState(data->ptr, data->len);
+        if (!sketch) {
             return 0;
         }
-        Extension* hll_ptr = new Extension(std::move(hll));
-        return reinterpret_cast<extension_state_t>(hll_ptr);
+        return reinterpret_cast<extension_state_t>(sketch.release());
     }
 
     uint32_t extension_hll_is_sparse(extension_state_t state) {
         if (state == 0) return 1;
-        Extension* hll = reinterpret_cast<Extension*>(state);
-        return hll->isSparse() ? 1 : 0;
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        return sketch->isSparse() ? 1 : 0;
     }
 
     uint32_t extension_hll_is_dense(extension_state_t state) {
         if (state == 0) return 0;
-        Extension* hll = reinterpret_cast<Extension*>(state);
-        return hll->isDense() ? 1 : 0;
+        SketchBase* sketch = reinterpret_cast<SketchBase*>(state);
+        return sketch->isDense() ? 1 : 0;
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,251 @@
+CREATE AGGREGATE hll_add_agg(LONGBLOB NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_compact(LONGBLOB NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize_compact
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_split(LONGBLOB NOT NULL, TEXT NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add_split
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_json_array(JSON NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add_json_array
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_multi2(LONGBLOB NOT NULL, LONGBLOB NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add_multi2
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_multi3(LONGBLOB NOT NULL, LONGBLOB NOT NULL, LONGBLOB NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add_multi3
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_multi2_bigint(BIGINT NOT NULL, BIGINT NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add_multi2_int
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_multi3_bigint(BIGINT NOT NULL, BIGINT NOT NULL, BIGINT NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add_multi3_int
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_multi_bigint_blob(BIGINT NOT NULL, LONGBLOB NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add_multi_int_bytes
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_budget(LONGBLOB NOT NULL, INT NOT NULL, BIGINT NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add_budgeted
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_union_agg(LONGBLOB NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_union_agg
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_union_agg_compact(LONGBLOB NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_union_agg
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize_compact
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_add_agg_cached(LONGBLOB NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize_cached
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_union_agg_cached(LONGBLOB NOT NULL)
+RETURNS LONGBLOB NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_union_agg
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_serialize_cached
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_count_distinct(LONGBLOB NOT NULL)
+RETURNS BIGINT NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_add
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_count
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE AGGREGATE hll_union_count(LONGBLOB NOT NULL)
+RETURNS BIGINT NOT NULL
+WITH STATE HANDLE
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+INITIALIZE WITH hll_empty
+ITERATE WITH hll_union_agg
+MERGE WITH hll_union_merge
+TERMINATE WITH hll_count
+SERIALIZE WITH hll_serialize_state
+DESERIALIZE WITH hll_deserialize_state;
+
+CREATE FUNCTION hll_cardinality
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-cardinality';
+
+CREATE FUNCTION hll_print
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-print';
+
+CREATE FUNCTION hll_stats
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-stats';
+
+CREATE FUNCTION hll_degraded_states
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-degraded-states';
+
+CREATE FUNCTION hll_debug_counters
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-debug-counters';
+
+CREATE FUNCTION hll_reset_debug_counters
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-reset-debug-counters';
+
+CREATE FUNCTION hll_union
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-union';
+
+CREATE FUNCTION hll_delta
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-delta';
+
+CREATE FUNCTION hll_apply_delta
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-apply-delta';
+
+CREATE FUNCTION hll_cache
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-cache';
+
+CREATE FUNCTION hll_from_datasketches
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-from-datasketches';
+
+CREATE FUNCTION hll_to_datasketches
+AS WASM FROM LOCAL INFILE "extension.wasm"
+WITH WIT FROM LOCAL INFILE "extension.wit"
+USING EXPORT 'hll-to-datasketches';
\ No newline at end of file
@@ -0,0 +1,2142 @@
+#ifndef HLL_SKETCH_H
+#define HLL_SKETCH_H
+
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <initializer_list>
+#include <functional>
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+// Header-only HyperLogLog sketch shared by the Wasm extension and native code.
+// Sketch<LgK> fixes the register count at compile time; SketchBase is the
+// runtime interface, and makeSketch()/deserialize() pick the instantiation.
+namespace hll {
+
+constexpr int DEFAULT_LG_K = 12;
+constexpr int MIN_LG_K = 4;
+constexpr int MAX_LG_K = 21;
+constexpr int HISTOGRAM_SIZE = 64;
+
+constexpr int VALUE_BITS = 7;
+constexpr uint8_t PREAMBLE_INTS_BYTE = 8;
+constexpr uint8_t SER_VER_BYTE = 1;
+constexpr uint8_t CACHED_PREAMBLE_INTS_BYTE = 12;
+constexpr uint8_t CACHED_SER_VER_BYTE = 2;
+// Sparse sketches keep their coupons at SPARSE_LG_K bits of slot (HLL++ p')
+// and are written with these versions; a sparseLgK byte follows lgK.
+constexpr uint8_t SPARSE_SER_VER_BYTE = 3;
+constexpr uint8_t CACHED_SPARSE_SER_VER_BYTE = 4;
+constexpr int SPARSE_LG_K = 25;
+constexpr size_t PREAMBLE_BYTES = 5;
+constexpr size_t CACHED_ESTIMATE_OFFSET = 5;
+constexpr uint8_t FAMILY_BYTE = 1;
+constexpr uint8_t COMPACT_FLAG_MASK = 8;
+constexpr uint8_t FULL_SIZE_FLAG_MASK = 32;
+constexpr uint8_t REDUCED_PRECISION_FLAG_MASK = 64;
+
+// Internal state transport between nodes (serializeState/deserializeState):
+// [STATE_FORMAT_BYTE, lgK, flags], then the K registers as-is when
+// FULL_SIZE_FLAG_MASK is set, or the coupon precision byte, a varint count and
+// a varint run of empty slots plus the value byte for each coupon. Never stored.
+constexpr uint8_t STATE_FORMAT_BYTE = 0x80;
+constexpr size_t STATE_HEADER_BYTES = 3;
+
+// Registers a sketch gained since an earlier snapshot (encodeDelta):
+// [DELTA_FORMAT_BYTE, lgK, flags, slot bits], a varint count, then a varint
+// run of unchanged slots plus the new value byte for each raised register.
+// Values are absolute, so applying a delta is a register-wise max. The flags
+// record the mode and layout of the newer blob (FULL_SIZE, COMPACT,
+// REDUCED_PRECISION and DELTA_CACHED_FLAG_MASK). Unlike states, deltas are
+// meant to be stored.
+constexpr uint8_t DELTA_FORMAT_BYTE = 0x81;
+constexpr size_t DELTA_HEADER_BYTES = 4;
+constexpr uint8_t DELTA_CACHED_FLAG_MASK = 16;
+
+constexpr uint8_t DS_SER_VER_BYTE = 1;
+constexpr uint8_t DS_FAMILY_BYTE = 7;
+constexpr uint8_t DS_LIST_PREINTS = 2;
+constexpr uint8_t DS_SET_PREINTS = 3;
+constexpr uint8_t DS_HLL_PREINTS = 10;
+constexpr uint8_t DS_EMPTY_FLAG_MASK = 4;
+constexpr uint8_t DS_OUT_OF_ORDER_FLAG_MASK = 16;
+constexpr int DS_MODE_LIST = 0;
+constexpr int DS_MODE_SET = 1;
+constexpr int DS_MODE_HLL = 2;
+constexpr int DS_KEY_BITS = 26;
+constexpr int DS_AUX_TOKEN = 15;
+constexpr size_t DS_LIST_INT_ARR_START = 8;
+constexpr size_t DS_SET_INT_ARR_START = 12;
+constexpr size_t DS_HLL_BYTE_ARR_START = 40;
+constexpr uint8_t DS_LG_AUX_ARR_INTS[MAX_LG_K + 1] = {
+    0, 2, 2, 2, 2, 2, 2, 3, 3, 3, 4, 4, 5, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+};
+
+inline constexpr double invPow2Table[64] = {
+    1.0,
+    0.5,
+    0.25,
+    0.125,
+    0.0625,
+    0.03125,
+    0.015625,
+    0.0078125,
+    0.00390625,
+    0.001953125,
+    0.0009765625,
+    0.00048828125,
+    0.000244140625,
+    0.0001220703125,
+    6.103515625e-05,
+    3.0517578125e-05,
+    1.52587890625e-05,
+    7.62939453125e-06,
+    3.814697265625e-06,
+    1.9073486328125e-06,
+    9.5367431640625e-07,
+    4.76837158203125e-07,
+    2.384185791015625e-07,
+    1.1920928955078125e-07,
+    5.960464477539063e-08,
+    2.980232238769531e-08,
+    1.490116119384766e-08,
+    7.450580596923828e-09,
+    3.725290298461914e-09,
+    1.862645149230957e-09,
+    9.313225746154785e-10,
+    4.656612873077393e-10,
+    2.328306436538696e-10,
+    1.164153218269348e-10,
+    5.820766091346741e-11,
+    2.910383045673370e-11,
+    1.455191522836685e-11,
+    7.275957614183426e-12,
+    3.637978807091713e-12,
+    1.818989403545857e-12,
+    9.094947017729282e-13,
+    4.547473508864641e-13,
+    2.2737367544323206e-13,
+    1.1368683772161603e-13,
+    5.684341886080802e-14,
+    2.842170943040401e-14,
+    1.4210854715202004e-14,
+    7.105427357601002e-15,
+    3.552713678800501e-15,
+    1.7763568394002505e-15,
+    8.881784197001252e-16,
+    4.440892098500626e-16,
+    2.220446049250313e-16,
+    1.1102230246251565e-16,
+    5.551115123125783e-17,
+    2.7755575615628914e-17,
+    1.3877787807814457e-17,
+    6.938893903907228e-18,
+    3.469446951953614e-18,
+    1.734723475976807e-18,
+    8.673617379884035e-19,
+    4.336808689942018e-19,
+    2.168404344971009e-19,
+    1.0842021724855044e-19,
+};
+
+inline uint64_t hash(const uint8_t* key, size_t len) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+
+    uint64_t h = 0x8445d61a4e774912 ^ (len * m);
+
+    const uint8_t* data = key;
+    const uint8_t* end = data + (len & ~7);
+
+    while (data != end) {
+        uint64_t k;
+        memcpy(&k, data, sizeof(uint64_t));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+
+        data += 8;
+    }
+
+    switch (len & 7) {
+    case 7: h ^= uint64_t(data[6]) << 48;
+    case 6: h ^= uint64_t(data[5]) << 40;
+    case 5: h ^= uint64_t(data[4]) << 32;
+    case 4: h ^= uint64_t(data[3]) << 24;
+    case 3: h ^= uint64_t(data[2]) << 16;
+    case 2: h ^= uint64_t(data[1]) << 8;
+    case 1: h ^= uint64_t(data[0]);
+            h *= m;
+    };
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+// Hash for integer fields: the 64-bit murmur finalizer, so no byte buffer is
+// needed. Integers and byte strings hash differently even when their text
+// matches, which is fine as long as a column is always added the same way.
+inline uint64_t hashInt(uint64_t value) {
+    value ^= 0x8445d61a4e774912ULL;
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+// Folds per-field hashes into one key hash. The combination is order
+// sensitive and mixes in the field count, so (a, b), (b, a) and (a, b, c)
+// are distinct keys, and there is no delimiter for values to collide with.
+inline uint64_t combineHashes(std::initializer_list<uint64_t> fieldHashes) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+
+    uint64_t h = 0x8445d61a4e774912 ^ (fieldHashes.size() * m);
+    for (uint64_t k : fieldHashes) {
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+    }
+    return hashInt(h);
+}
+
+inline void writeVarInt(std::vector<uint8_t>& buffer, uint32_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<uint8_t>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<uint8_t>(value & 0x7F));
+}
+
+inline bool readVarInt(const uint8_t* data, size_t len, size_t& offset, uint32_t& value) {
+    value = 0;
+    int shift = 0;
+    while (offset < len) {
+        uint8_t byte = data[offset++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+        shift += 7;
+        if (shift > 28) {
+            return false;
+        }
+    }
+    return false;
+}
+
+inline uint32_t readLE32(const uint8_t* src) {
+    uint32_t value;
+    memcpy(&value, src, sizeof(uint32_t));
+    return value;
+}
+
+inline void writeLE32(uint8_t* dst, uint32_t value) {
+    memcpy(dst, &value, sizeof(uint32_t));
+}
+
+inline void packBits(const uint8_t* input, uint8_t* output, size_t numItems, int srcBits) {
+    size_t dstBytePos = 0;
+
+    uint32_t accumulator = 0;
+    int bitsInAccumulator = 0;
+
+    for (size_t i = 0; i < numItems; ++i) {
+        accumulator = (accumulator << srcBits) | (input[i] & ((1 << srcBits) - 1));
+        bitsInAccumulator += srcBits;
+
+        while (bitsInAccumulator >= 8) {
+            bitsInAccumulator -= 8;
+            output[dstBytePos++] = (accumulator >> bitsInAccumulator) & 0xFF;
+        }
+    }
+
+    if (bitsInAccumulator > 0) {
+        output[dstBytePos++] = (accumulator << (8 - bitsInAccumulator)) & 0xFF;
+    }
+}
+
+inline bool unpackBits(const uint8_t* input, size_t inputLen, uint8_t* output,
+                       size_t numItems, int dstBits) {
+    size_t srcBytePos = 0;
+    int bitsInAccumulator = 0;
+    uint32_t accumulator = 0;
+    int dstMask = (1 << dstBits) - 1;
+
+    for (size_t i = 0; i < numItems; ++i) {
+        while (bitsInAccumulator < dstBits) {
+            if (srcBytePos >= inputLen) {
+                return false;
+            }
+            accumulator = (accumulator << 8) | input[srcBytePos++];
+            bitsInAccumulator += 8;
+        }
+        bitsInAccumulator -= dstBits;
+        output[i] = (accumulator >> bitsInAccumulator) & dstMask;
+    }
+    return true;
+}
+
+inline double estimateFromHistogram(int k, const uint32_t* histogram,
+                                    const char** estimator = nullptr) {
+    double sum = 0.0;
+    for (int v = 0; v < HISTOGRAM_SIZE; ++v) {
+        sum += histogram[v] * invPow2Table[v];
+    }
+    uint32_t zeros = histogram[0];
+
+    double estimate_value;
+    double alpha;
+    switch (k) {
+        case 16: alpha = 0.673; break;
+        case 32: alpha = 0.697; break;
+        case 64: alpha = 0.709; break;
+        default: alpha = 0.7213 / (1.0 + 1.079 / k); break;
+    }
+    estimate_value = alpha * k * k / sum;
+    const char* used = "raw";
+
+    if (estimate_value <= 2.5 * k) {
+        if (zeros != 0) {
+            estimate_value = k * log(static_cast<double>(k) / zeros);
+            used = "linear_counting";
+        }
+    } else if (estimate_value > (1.0 / 30.0) * (1ULL << 32)) {
+        estimate_value = -(1ULL << 32) * log(1.0 - (estimate_value / (1ULL << 32)));
+        used = "large_range";
+    }
+
+    if (estimator != nullptr) {
+        *estimator = used;
+    }
+    return estimate_value;
+}
+
+// Linear counting over the 2^sparseLgK coupon slots of a high-precision
+// sparse sketch; numCoupons stays far below that, so this is nearly exact.
+inline double estimateSparse(int sparseLgK, uint32_t numCoupons) {
+    double m = static_cast<double>(1u << sparseLgK);
+    return m * log(m / (m - numCoupons));
+}
+
+// Maps register (slot, value) of a sketch with fromLgK onto the coupon of the
+// register a sketch with the smaller toLgK would have set from the same hash:
+// the low bits dropped from the slot become the leading bits of the rank word.
+inline uint32_t foldCoupon(uint32_t slot, uint8_t value, int fromLgK, int toLgK) {
+    int shift = fromLgK - toLgK;
+    uint32_t low = slot & ((1u << shift) - 1);
+    int rank = low != 0 ? shift - (32 - __builtin_clz(low)) + 1 : shift + value;
+    return ((slot >> shift) << VALUE_BITS) | static_cast<uint32_t>(rank);
+}
+
+struct Header {
+    int lgK;
+    int sparseLgK;
+    int serVer;
+    bool isDense;
+    bool isCompact;
+    bool isCached;
+    bool isReducedPrecision;
+};
+
+// Validates the fixed preamble and leaves offset just past it.
+inline bool parseHeader(const uint8_t* data, size_t len, Header& header, size_t& offset) {
+    if (data == nullptr || len < PREAMBLE_BYTES || data[2] != FAMILY_BYTE) {
+        return false;
+    }
+    bool isSparseVersion = data[1] == SPARSE_SER_VER_BYTE || data[1] == CACHED_SPARSE_SER_VER_BYTE;
+    header.isCached = data[0] == CACHED_PREAMBLE_INTS_BYTE &&
+                      (data[1] == CACHED_SER_VER_BYTE || data[1] == CACHED_SPARSE_SER_VER_BYTE);
+    if (!header.isCached && (data[0] != PREAMBLE_INTS_BYTE ||
+                             (data[1] != SER_VER_BYTE && data[1] != SPARSE_SER_VER_BYTE))) {
+        return false;
+    }
+    header.serVer = data[1];
+    header.isDense = (data[3] & FULL_SIZE_FLAG_MASK) != 0;
+    header.isCompact = (data[3] & COMPACT_FLAG_MASK) != 0;
+    header.isReducedPrecision = (data[3] & REDUCED_PRECISION_FLAG_MASK) != 0;
+    header.lgK = data[4];
+    if (header.lgK < MIN_LG_K || header.lgK > MAX_LG_K) {
+        return false;
+    }
+    offset = PREAMBLE_BYTES;
+    header.sparseLgK = header.lgK;
+    if (isSparseVersion) {
+        if (len <= offset || header.isDense) {
+            return false;
+        }
+        header.sparseLgK = data[offset++];
+        if (header.sparseLgK <= header.lgK || header.sparseLgK > SPARSE_LG_K) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool isCompactEncoding(const uint8_t* data, size_t len) {
+    return len >= 4 && (data[3] & COMPACT_FLAG_MASK) != 0;
+}
+
+inline bool readCachedEstimate(const uint8_t* data, size_t len, double& value) {
+    if (len < CACHED_ESTIMATE_OFFSET + 1 + sizeof(double) ||
+        data[0] != CACHED_PREAMBLE_INTS_BYTE || data[2] != FAMILY_BYTE) {
+        return false;
+    }
+    size_t offset;
+    if (data[1] == CACHED_SER_VER_BYTE) {
+        offset = CACHED_ESTIMATE_OFFSET;
+    } else if (data[1] == CACHED_SPARSE_SER_VER_BYTE) {
+        offset = CACHED_ESTIMATE_OFFSET + 1;
+    } else {
+        return false;
+    }
+    memcpy(&value, data + offset, sizeof(double));
+    return true;
+}
+
+// Reads the histogram of the extended preamble; offset must point at the estimate.
+inline bool readCachedHistogram(const uint8_t* data, size_t len, size_t& offset,
+                                uint32_t* histogram) {
+    if (len < offset + sizeof(double) + 1) return false;
+    offset += sizeof(double);
+    int histogramLen = data[offset++];
+    if (histogramLen == 0 || histogramLen > HISTOGRAM_SIZE) return false;
+    std::fill(histogram, histogram + HISTOGRAM_SIZE, 0);
+    for (int i = 0; i < histogramLen; ++i) {
+        if (!readVarInt(data, len, offset, histogram[i])) return false;
+    }
+    return true;
+}
+
+inline bool isDataSketchesBlob(const uint8_t* data, size_t len) {
+    return data != nullptr && len >= DS_LIST_INT_ARR_START && data[2] == DS_FAMILY_BYTE;
+}
+
+inline int dataSketchesLgK(const uint8_t* data, size_t len) {
+    return isDataSketchesBlob(data, len) ? data[3] : -1;
+}
+
+inline bool isDeltaBlob(const uint8_t* data, size_t len) {
+    return data != nullptr && len > DELTA_HEADER_BYTES && data[0] == DELTA_FORMAT_BYTE &&
+           data[1] >= MIN_LG_K && data[1] <= MAX_LG_K && data[3] >= data[1] && data[3] <= SPARSE_LG_K;
+}
+
+// Calls f(slot, value) for every register of a delta blob, in slot order;
+// returns false if the payload is malformed.
+template <typename F>
+bool forEachDeltaRegister(const uint8_t* data, size_t len, F&& f) {
+    size_t offset = DELTA_HEADER_BYTES;
+    int lg = data[3];
+    uint32_t count;
+    if (!readVarInt(data, len, offset, count)) {
+        return false;
+    }
+    uint32_t slotNo = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t zeros;
+        if (!readVarInt(data, len, offset, zeros) || offset >= len ||
+            zeros >= (1u << lg) - slotNo) {
+            return false;
+        }
+        slotNo += zeros;
+        uint8_t value = data[offset++];
+        if (value == 0 || value > 64 - lg + 1) {
+            return false;
+        }
+        f(slotNo, value);
+        slotNo++;
+    }
+    return offset == len;
+}
+
+inline size_t dsHllArrayBytes(int tgtHllType, int lgK) {
+    int k = 1 << lgK;
+    switch (tgtHllType) {
+        case 0: return k / 2;
+        case 1: return ((k * 3) >> 2) + 1;
+        default: return k;
+    }
+}
+
+struct Stats {
+    int lgK;
+    int sparseLgK;
+    int serVer;
+    bool isDense;
+    bool isCompact;
+    bool isCached;
+    bool isReducedPrecision;
+    uint32_t numNonZero;
+    uint32_t numCoupons;
+    uint32_t histogram[HISTOGRAM_SIZE];
+};
+
+// Walks an encoded sketch once, straight from the buffer, and fills in the
+// register-value histogram. Cached blobs already carry the histogram.
+inline bool scanStats(const uint8_t* data, size_t len, Stats& stats) {
+    Header header;
+    size_t offset;
+    if (!parseHeader(data, len, header, offset)) {
+        return false;
+    }
+    stats.lgK = header.lgK;
+    stats.sparseLgK = header.sparseLgK;
+    stats.serVer = header.serVer;
+    stats.isDense = header.isDense;
+    stats.isCompact = header.isCompact;
+    stats.isCached = header.isCached;
+    stats.isReducedPrecision = header.isReducedPrecision;
+
+    uint32_t* histogram = stats.histogram;
+    std::fill(histogram, histogram + HISTOGRAM_SIZE, 0);
+    uint32_t k = 1u << stats.lgK;
+
+    if (stats.isCached) {
+        if (!readCachedHistogram(data, len, offset, histogram)) return false;
+        stats.numNonZero = k - histogram[0];
+        stats.numCoupons = stats.numNonZero;
+        if (!stats.isDense && !readVarInt(data, len, offset, stats.numCoupons)) return false;
+        return true;
+    }
+
+    uint32_t valueMask = (1 << VALUE_BITS) - 1;
+    if (!stats.isDense && stats.sparseLgK > stats.lgK) {
+        // High-precision coupons: fold each one down to its lgK register.
+        // Coupons are written in slot order, so the coupons of one register
+        // arrive together and only its running maximum has to be kept.
+        uint32_t numCoupons;
+        if (!readVarInt(data, len, offset, numCoupons)) return false;
+        uint32_t sparseK = 1u << stats.sparseLgK;
+        int maxValue = 64 - stats.sparseLgK + 1;
+        uint32_t coupon = 0;
+        uint32_t previousSlot = 0;
+        uint32_t currentReg = 0;
+        uint8_t currentMax = 0;
+        uint32_t numNonZero = 0;
+        for (uint32_t i = 0; i < numCoupons; ++i) {
+            uint32_t slot;
+            uint8_t value;
+            if (stats.isCompact) {
+                uint32_t delta;
+                if (!readVarInt(data, len, offset, delta)) return false;
+                coupon += delta;
+                slot = coupon >> VALUE_BITS;
+                value = coupon & valueMask;
+            } else {
+                if (!readVarInt(data, len, offset, slot) || offset >= len) return false;
+                value = data[offset++];
+            }
+            if (slot >= sparseK || value == 0 || value > maxValue || (i > 0 && slot <= previousSlot)) {
+                return false;
+            }
+            previousSlot = slot;
+            uint32_t folded = foldCoupon(slot, value, stats.sparseLgK, stats.lgK);
+            uint8_t foldedValue = static_cast<uint8_t>(folded & valueMask);
+            if (i > 0 && (folded >> VALUE_BITS) == currentReg) {
+                currentMax = std::max(currentMax, foldedValue);
+                continue;
+            }
+            if (i > 0) {
+                histogram[currentMax & (HISTOGRAM_SIZE - 1)]++;
+            }
+            currentReg = folded >> VALUE_BITS;
+            currentMax = foldedValue;
+            numNonZero++;
+        }
+        if (numCoupons > 0) {
+            histogram[currentMax & (HISTOGRAM_SIZE - 1)]++;
+        }
+        histogram[0] = k - numNonZero;
+        stats.numNonZero = numNonZero;
+        stats.numCoupons = numCoupons;
+        return true;
+    }
+    if (!stats.isDense) {
+        uint32_t count = 0;
+        if (stats.isCompact) {
+            uint32_t numNonZero;
+            if (!readVarInt(data, len, offset, numNonZero)) return false;
+            for (; count < numNonZero; ++count) {
+                uint32_t pair;
+                if (!readVarInt(data, len, offset, pair) || (pair >> VALUE_BITS) >= k) return false;
+                histogram[(pair & valueMask) & (HISTOGRAM_SIZE - 1)]++;
+            }
+        } else {
+            uint32_t ignored;
+            if (!readVarInt(data, len, offset, ignored)) return false;
+            while (offset < len) {
+                uint32_t index;
+                if (!readVarInt(data, len, offset, index) || offset >= len || index >= k) return false;
+                histogram[data[offset++] & (HISTOGRAM_SIZE - 1)]++;
+                count++;
+            }
+        }
+        if (count > k) return false;
+        histogram[0] += k - count;
+    } else if (stats.isCompact) {
+        uint32_t accumulator = 0;
+        int bitsInAccumulator = 0;
+        for (uint32_t i = 0; i < k; ++i) {
+            while (bitsInAccumulator < VALUE_BITS) {
+                if (offset >= len) return false;
+                accumulator = (accumulator << 8) | data[offset++];
+                bitsInAccumulator += 8;
+            }
+            bitsInAccumulator -= VALUE_BITS;
+            histogram[((accumulator >> bitsInAccumulator) & valueMask) & (HISTOGRAM_SIZE - 1)]++;
+        }
+    } else {
+        if (len != offset + k) return false;
+        for (uint32_t i = 0; i < k; ++i) {
+            histogram[data[offset + i] & (HISTOGRAM_SIZE - 1)]++;
+        }
+    }
+
+    stats.numNonZero = k - histogram[0];
+    stats.numCoupons = stats.numNonZero;
+    return true;
+}
+
+// Formats the stats as a JSON object.
+inline std::string formatStats(const Stats& stats, size_t encodedBytes) {
+    int k = 1 << stats.lgK;
+    const char* estimator;
+    double estimate_value;
+    // The error at the sketch's lgK, which is what it converges to as it grows,
+    // even while a high-precision sparse estimate is still closer.
+    double standardError = 1.04 / std::sqrt(static_cast<double>(k));
+    if (!stats.isDense && stats.sparseLgK > stats.lgK) {
+        estimate_value = estimateSparse(stats.sparseLgK, stats.numCoupons);
+        estimator = "sparse_linear_counting";
+    } else {
+        estimate_value = estimateFromHistogram(k, stats.histogram, &estimator);
+    }
+
+    char number[32];
+    std::string json = "{\"mode\":\"";
+    json += stats.isDense ? "dense" : "sparse";
+    json += "\",\"lg_k\":" + std::to_string(stats.lgK);
+    json += ",\"k\":" + std::to_string(k);
+    json += ",\"format\":\"";
+    json += stats.isCompact ? "compact" : "standard";
+    json += "\",\"version\":" + std::to_string(stats.serVer);
+    json += ",\"cached\":";
+    json += stats.isCached ? "true" : "false";
+    json += ",\"reduced_precision\":";
+    json += stats.isReducedPrecision ? "true" : "false";
+    json += ",\"encoded_bytes\":" + std::to_string(encodedBytes);
+    json += ",\"num_non_zero\":" + std::to_string(stats.numNonZero);
+    json += ",\"sparse_lg_k\":" + std::to_string(stats.sparseLgK);
+    json += ",\"num_coupons\":" + std::to_string(stats.numCoupons);
+    json += ",\"histogram\":[";
+    int histogramLen = HISTOGRAM_SIZE;
+    while (histogramLen > 1 && stats.histogram[histogramLen - 1] == 0) {
+        histogramLen--;
+    }
+    for (int i = 0; i < histogramLen; ++i) {
+        if (i > 0) json += ",";
+        json += std::to_string(stats.histogram[i]);
+    }
+    snprintf(number, sizeof(number), "%.17g", estimate_value);
+    json += "],\"estimate\":";
+    json += number;
+    json += ",\"estimator\":\"";
+    json += estimator;
+    snprintf(number, sizeof(number), "%.6g", standardError);
+    json += "\",\"relative_standard_error\":";
+    json += number;
+    json += "}";
+    return json;
+}
+
+// Calls f(ptr, len) for each non-empty piece of data between delimiters,
+// pointing into data itself. An empty delimiter yields data as a single piece.
+template <typename F>
+void forEachDelimited(const uint8_t* data, size_t len,
+                      const uint8_t* delimiter, size_t delimiterLen, F&& f) {
+    if (delimiter == nullptr || delimiterLen == 0) {
+        if (len > 0) f(data, len);
+        return;
+    }
+    const uint8_t* pos = data;
+    const uint8_t* end = data + len;
+    const uint8_t* pieceStart = data;
+    while (static_cast<size_t>(end - pos) >= delimiterLen) {
+        const uint8_t* hit = static_cast<const uint8_t*>(
+            memchr(pos, delimiter[0], (end - pos) - delimiterLen + 1));
+        if (hit == nullptr) {
+            break;
+        }
+        if (memcmp(hit, delimiter, delimiterLen) != 0) {
+            pos = hit + 1;
+            continue;
+        }
+        if (hit > pieceStart) f(pieceStart, hit - pieceStart);
+        pos = pieceStart = hit + delimiterLen;
+    }
+    if (end > pieceStart) f(pieceStart, end - pieceStart);
+}
+
+inline bool isJsonSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+inline bool readJsonHex4(const char* data, size_t len, size_t pos, uint32_t& value) {
+    if (pos + 4 > len) return false;
+    value = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = data[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+// Decodes the body of a JSON string (without its quotes) into out.
+inline bool decodeJsonString(const char* data, size_t len, std::string& out) {
+    out.clear();
+    for (size_t pos = 0; pos < len; ++pos) {
+        if (data[pos] != '\\') {
+            out.push_back(data[pos]);
+            continue;
+        }
+        if (++pos >= len) return false;
+        switch (data[pos]) {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                uint32_t cp;
+                if (!readJsonHex4(data, len, pos + 1, cp)) return false;
+                pos += 4;
+                uint32_t low;
+                if (cp >= 0xD800 && cp < 0xDC00 && pos + 2 < len &&
+                    data[pos + 1] == '\\' && data[pos + 2] == 'u' &&
+                    readJsonHex4(data, len, pos + 3, low) && low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                }
+                appendUtf8(out, cp);
+                break;
+            }
+            default: return false;
+        }
+    }
+    return true;
+}
+
+// Advances pos past the JSON array or object that starts at pos.
+inline bool skipJsonContainer(const char* data, size_t len, size_t& pos) {
+    int depth = 0;
+    while (pos < len) {
+        char c = data[pos++];
+        if (c == '"') {
+            while (pos < len && data[pos] != '"') {
+                pos += data[pos] == '\\' ? 2 : 1;
+            }
+            if (pos++ >= len) return false;
+        } else if (c == '[' || c == '{') {
+            depth++;
+        } else if (c == ']' || c == '}') {
+            if (--depth == 0) return true;
+        }
+    }
+    return false;
+}
+
+// Calls f(ptr, len) for each element of a top-level JSON array. Strings are
+// passed without their quotes and point into data unless they contain escapes,
+// which are decoded into a scratch buffer. Numbers, booleans, nested arrays and
+// objects are passed as their JSON text; nulls are skipped. Returns false on
+// malformed input, after the elements before the error have been visited.
+template <typename F>
+bool forEachJsonArrayElement(const char* data, size_t len, F&& f) {
+    size_t pos = 0;
+    while (pos < len && isJsonSpace(data[pos])) pos++;
+    if (pos >= len || data[pos] != '[') return false;
+    pos++;
+    while (pos < len && isJsonSpace(data[pos])) pos++;
+    if (pos < len && data[pos] == ']') return true;
+
+    std::string scratch;
+    while (pos < len) {
+        while (pos < len && isJsonSpace(data[pos])) pos++;
+        if (pos >= len) return false;
+
+        size_t start = pos;
+        char c = data[pos];
+        if (c == '"') {
+            bool escaped = false;
+            start = ++pos;
+            while (pos < len && data[pos] != '"') {
+                if (data[pos] == '\\') {
+                    escaped = true;
+                    pos += 2;
+                } else {
+                    pos++;
+                }
+            }
+            if (pos >= len) return false;
+            if (!escaped) {
+                f(reinterpret_cast<const uint8_t*>(data + start), pos - start);
+            } else {
+                if (!decodeJsonString(data + start, pos - start, scratch)) return false;
+                f(reinterpret_cast<const uint8_t*>(scratch.data()), scratch.size());
+            }
+            pos++;
+        } else if (c == '[' || c == '{') {
+            if (!skipJsonContainer(data, len, pos)) return false;
+            f(reinterpret_cast<const uint8_t*>(data + start), pos - start);
+        } else {
+            while (pos < len && data[pos] != ',' && data[pos] != ']' && !isJsonSpace(data[pos])) pos++;
+            if (pos == start) return false;
+            if (pos - start != 4 || memcmp(data + start, "null", 4) != 0) {
+                f(reinterpret_cast<const uint8_t*>(data + start), pos - start);
+            }
+        }
+
+        while (pos < len && isJsonSpace(data[pos])) pos++;
+        if (pos >= len) return false;
+        if (data[pos] == ']') return true;
+        if (data[pos++] != ',') return false;
+    }
+    return false;
+}
+
+// Calls f with std::integral_constant<int, lgK> for lgK in [MIN_LG_K, MAX_LG_K];
+// anything else is clamped into range first.
+template <typename F>
+decltype(auto) dispatchLgK(int lgK, F&& f) {
+    switch (std::clamp(lgK, MIN_LG_K, MAX_LG_K)) {
+        case 4: return f(std::integral_constant<int, 4>{});
+        case 5: return f(std::integral_constant<int, 5>{});
+        case 6: return f(std::integral_constant<int, 6>{});
+        case 7: return f(std::integral_constant<int, 7>{});
+        case 8: return f(std::integral_constant<int, 8>{});
+        case 9: return f(std::integral_constant<int, 9>{});
+        case 10: return f(std::integral_constant<int, 10>{});
+        case 11: return f(std::integral_constant<int, 11>{});
+        case 12: return f(std::integral_constant<int, 12>{});
+        case 13: return f(std::integral_constant<int, 13>{});
+        case 14: return f(std::integral_constant<int, 14>{});
+        case 15: return f(std::integral_constant<int, 15>{});
+        case 16: return f(std::integral_constant<int, 16>{});
+        case 17: return f(std::integral_constant<int, 17>{});
+        case 18: return f(std::integral_constant<int, 18>{});
+        case 19: return f(std::integral_constant<int, 19>{});
+        case 20: return f(std::integral_constant<int, 20>{});
+        default: return f(std::integral_constant<int, 21>{});
+    }
+}
+
+// Process-wide counters on the hot paths, for explaining slow or surprising
+// rollups. They are only compiled in with -DHLL_DEBUG_COUNTERS; otherwise
+// HLL_COUNT() expands to nothing. Relaxed atomics keep them race-free when
+// native code updates sketches from several threads.
+#ifdef HLL_DEBUG_COUNTERS
+struct DebugCounters {
+    std::atomic<uint64_t> updates{0};          // hashes passed to updateWithHash()
+    std::atomic<uint64_t> registerChanges{0};  // updates that raised a register or coupon
+    std::atomic<uint64_t> densePromotions{0};
+    std::atomic<uint64_t> rejectedInputs{0};   // blobs refused by the deserializers
+    std::atomic<uint64_t> bytesStandard{0};
+    std::atomic<uint64_t> bytesCompact{0};
+    std::atomic<uint64_t> bytesDataSketches{0};
+    std::atomic<uint64_t> bytesState{0};
+    std::atomic<uint64_t> mergesDense{0};      // register-array max of equal lgK
+    std::atomic<uint64_t> mergesSparse{0};     // coupon-wise, equal lgK
+    std::atomic<uint64_t> mergesFolded{0};     // folded from a larger lgK
+    std::atomic<uint64_t> mergesDataSketches{0};
+    std::atomic<uint64_t> mergesDelta{0};
+};
+
+inline DebugCounters debugCounters;
+
+#define HLL_COUNT(counter, n) ::hll::debugCounters.counter.fetch_add((n), std::memory_order_relaxed)
+#else
+#define HLL_COUNT(counter, n) ((void)0)
+#endif
+
+// The counters as a JSON object, zeroing them when reset is set;
+// {"enabled":false} when they are not compiled in.
+inline std::string debugCountersJson(bool reset = false) {
+#ifdef HLL_DEBUG_COUNTERS
+    DebugCounters& c = debugCounters;
+    const std::pair<const char*, std::atomic<uint64_t>*> fields[] = {
+        {"updates", &c.updates},
+        {"register_changes", &c.registerChanges},
+        {"dense_promotions", &c.densePromotions},
+        {"rejected_inputs", &c.rejectedInputs},
+        {"bytes_standard", &c.bytesStandard},
+        {"bytes_compact", &c.bytesCompact},
+        {"bytes_datasketches", &c.bytesDataSketches},
+        {"bytes_state", &c.bytesState},
+        {"merges_dense", &c.mergesDense},
+        {"merges_sparse", &c.mergesSparse},
+        {"merges_folded", &c.mergesFolded},
+        {"merges_datasketches", &c.mergesDataSketches},
+        {"merges_delta", &c.mergesDelta},
+    };
+    std::string json = "{\"enabled\":true";
+    for (const auto& field : fields) {
+        uint64_t value = reset ? field.second->exchange(0, std::memory_order_relaxed)
+                               : field.second->load(std::memory_order_relaxed);
+        json += ",\"";
+        json += field.first;
+        json += "\":";
+        json += std::to_string(value);
+    }
+    return json + "}";
+#else
+    (void)reset;
+    return "{\"enabled\":false}";
+#endif
+}
+
+// Byte budget shared by a group of sketches. Attached sketches charge their
+// allocations to it; what to do once it is exceeded is up to the caller,
+// typically folding large sketches with SketchBase::foldTo().
+struct MemoryBudget {
+    size_t limit = 0; // 0 = unlimited
+    size_t used = 0;
+    uint64_t degradedStates = 0;
+
+    bool overLimit() const { return limit != 0 && used > limit; }
+};
+
+class SketchBase {
+public:
+    SketchBase() = default;
+    // Copies start out unattached, so a budget is never charged twice.
+    SketchBase(const SketchBase& other) : reducedPrecision(other.reducedPrecision) {}
+    SketchBase& operator=(const SketchBase&) = delete;
+
+    virtual ~SketchBase() {
+        if (budget != nullptr) {
+            budget->used -= chargedBytes;
+        }
+    }
+
+    virtual int lgK() const = 0;
+    virtual bool isDense() const = 0;
+    bool isSparse() const { return !isDense(); }
+    virtual bool isEmpty() const = 0;
+
+    // Set when the sketch was folded below the precision it was created with.
+    bool isReducedPrecision() const { return reducedPrecision; }
+    void markReducedPrecision() { reducedPrecision = true; }
+
+    // Heap and object bytes currently held by the sketch.
+    virtual size_t memoryUsage() const = 0;
+
+    void attachBudget(MemoryBudget* newBudget) {
+        if (budget == newBudget) {
+            return;
+        }
+        if (budget != nullptr) {
+            budget->used -= chargedBytes;
+        }
+        budget = newBudget;
+        chargedBytes = 0;
+        syncBudget();
+    }
+
+    virtual std::unique_ptr<SketchBase> clone() const = 0;
+
+    virtual void updateWithHash(uint64_t hashValue) = 0;
+
+    void update(const uint8_t* key, size_t len) {
+        if (key == nullptr || len == 0) {
+            return;
+        }
+        updateWithHash(hash(key, len));
+    }
+
+    // Adds every delimiter-separated piece of data as its own key.
+    virtual void updateDelimited(const uint8_t* data, size_t len,
+                                 const uint8_t* delimiter, size_t delimiterLen) = 0;
+
+    // Adds every element of a JSON array as its own key; see forEachJsonArrayElement.
+    // Malformed input adds nothing and returns false.
+    virtual bool updateJsonArray(const char* data, size_t len) = 0;
+
+    virtual void toDense() = 0;
+    virtual void computeHistogram(uint32_t* histogram) const = 0;
+    virtual double estimate() const = 0;
+
+    // Slot bits of the registers forEachRegister reports: the coupon precision
+    // while sparse, lgK once dense.
+    virtual int registerLgK() const = 0;
+
+    // Calls f(slot, value) for every non-zero register, in no particular order.
+    virtual void forEachRegister(const std::function<void(uint32_t, uint8_t)>& f) const = 0;
+
+    // Sketches with a larger lgK are folded down register by register; sketches
+    // with a smaller lgK are ignored (fold this one with foldTo() first).
+    virtual void merge(const SketchBase& other) = 0;
+
+    // Returns a copy with lgK lowered to targetLgK, flagged as reduced precision.
+    // The result is what a sketch of that size would hold for the same input.
+    virtual std::unique_ptr<SketchBase> foldTo(int targetLgK) const = 0;
+
+    // Folds a DataSketches HLL blob (LIST, SET or HLL mode, any target type)
+    // straight into the registers without building an intermediate sketch.
+    // DataSketches takes the slot from the low hash bits and the value from an
+    // independent hash word, so a blob with a larger lgK folds down by masking.
+    virtual bool mergeDataSketches(const uint8_t* data, size_t len) = 0;
+
+    // Raises the registers listed in a delta blob (see DELTA_FORMAT_BYTE).
+    // Its slot bits must be at least lgK(); a larger delta lgK is folded.
+    virtual bool applyDelta(const uint8_t* data, size_t len) = 0;
+
+    virtual std::vector<uint8_t> serialize(bool withCache = false) const = 0;
+    virtual std::vector<uint8_t> serialize_compact(bool withCache = false) const = 0;
+
+    // Writes an HLL-mode DataSketches image (tgtHllType 0/1/2 = HLL_4/HLL_6/HLL_8).
+    // There is no HIP accumulator to carry over, so the sketch is flagged out of
+    // order and DataSketches falls back to its composite estimator.
+    virtual std::vector<uint8_t> serialize_datasketches(int tgtHllType) const = 0;
+
+    virtual std::string toString() const = 0;
+
+    // Fills the registers from the payload that follows a parsed header.
+    virtual bool load(const Header& header, const uint8_t* data, size_t len, size_t offset) = 0;
+
+    // Internal transport format (see STATE_FORMAT_BYTE). Only bounds are
+    // checked on load, and the format may change between releases.
+    virtual std::vector<uint8_t> serializeState() const = 0;
+    virtual bool loadState(const uint8_t* data, size_t len) = 0;
+
+protected:
+    bool reducedPrecision = false;
+
+    void syncBudget() {
+        if (budget == nullptr) {
+            return;
+        }
+        size_t bytes = memoryUsage();
+        budget->used = budget->used - chargedBytes + bytes;
+        chargedBytes = bytes;
+    }
+
+private:
+    MemoryBudget* budget = nullptr;
+    size_t chargedBytes = 0;
+};
+
+inline std::unique_ptr<SketchBase> makeSketch(int lgK = DEFAULT_LG_K);
+
+template <int LgK>
+class ConcurrentSketch;
+
+template <int LgK>
+class Sketch final : public SketchBase {
+    static_assert(LgK >= MIN_LG_K && LgK <= MAX_LG_K, "lgK out of range");
+
+    friend class ConcurrentSketch<LgK>;
+
+public:
+    static constexpr int K = 1 << LgK;
+
+private:
+    // Sparse mode keeps only the non-zero registers, as coupons in an
+    // open-addressing table probed from the slot (0 marks an empty entry), so a
+    // small sketch costs a few bytes rather than K. The coupons use sparseLgK
+    // bits of slot, normally SPARSE_LG_K, and are folded down to LgK when the
+    // sketch turns dense. Dense mode holds the full register array and leaves
+    // the table empty. numNonZero counts coupons while sparse; in dense mode
+    // registerHistogram counts the registers holding each value and is kept up
+    // to date on every register increase, so estimates never rescan the array.
+    std::vector<uint32_t> coupons;
+    std::vector<uint8_t> buckets;
+    std::vector<uint32_t> registerHistogram;
+    int sparseLgK;
+    int64_t numNonZero;
+    bool isDenseMode;
+    bool hasCachedEstimate;
+    double cachedEstimate;
+
+    static constexpr uint32_t VALUE_MASK = (1 << VALUE_BITS) - 1;
+    static constexpr size_t MIN_TABLE_SIZE = 4;
+
+    size_t findCoupon(uint32_t slotNo) const {
+        size_t mask = coupons.size() - 1;
+        size_t i = slotNo & mask;
+        while (coupons[i] != 0 && (coupons[i] >> VALUE_BITS) != slotNo) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void growTable() {
+        std::vector<uint32_t> old;
+        old.swap(coupons);
+        coupons.assign(old.empty() ? MIN_TABLE_SIZE : old.size() * 2, 0);
+        for (uint32_t coupon : old) {
+            if (coupon != 0) {
+                coupons[findCoupon(coupon >> VALUE_BITS)] = coupon;
+            }
+        }
+        syncBudget();
+    }
+
+    // Raises a coupon in the sparse table without promoting or touching the
+    // cached estimate; returns true when the table changed.
+    bool sparseInsert(uint32_t slotNo, uint8_t value) {
+        if (4 * (numNonZero + 1) > 3 * static_cast<int64_t>(coupons.size())) {
+            growTable();
+        }
+        uint32_t& entry = coupons[findCoupon(slotNo)];
+        if (entry == 0) {
+            numNonZero++;
+        } else if ((entry & VALUE_MASK) >= value) {
+            return false;
+        }
+        entry = (slotNo << VALUE_BITS) | value;
+        return true;
+    }
+
+    void reserveCoupons(size_t count) {
+        size_t size = MIN_TABLE_SIZE;
+        while (4 * count > 3 * size) {
+            size *= 2;
+        }
+        if (size > coupons.size()) {
+            coupons.assign(size, 0);
+        }
+    }
+
+    // Non-zero sparse coupons in slot order.
+    std::vector<uint32_t> sortedCoupons() const {
+        std::vector<uint32_t> sorted;
+        sorted.reserve(numNonZero);
+        for (uint32_t coupon : coupons) {
+            if (coupon != 0) {
+                sorted.push_back(coupon);
+            }
+        }
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    }
+
+    // The full register array; sparse sketches are folded into scratch.
+    const uint8_t* denseRegisters(std::vector<uint8_t>& scratch) const {
+        if (isDenseMode) {
+            return buckets.data();
+        }
+        scratch.assign(K, 0);
+        for (uint32_t coupon : coupons) {
+            if (coupon != 0) {
+                uint32_t folded = foldCoupon(coupon >> VALUE_BITS, coupon & VALUE_MASK, sparseLgK, LgK);
+                uint8_t& reg = scratch[folded >> VALUE_BITS];
+                reg = std::max(reg, static_cast<uint8_t>(folded & VALUE_MASK));
+            }
+        }
+        return scratch.data();
+    }
+
+    bool isHighPrecisionSparse() const { return !isDenseMode && sparseLgK > LgK; }
+
+    // Raises a dense register, moving it to its new histogram bucket; returns
+    // true when the register changed.
+    bool raiseRegister(uint32_t slotNo, uint8_t value) {
+        uint8_t& reg = buckets[slotNo];
+        if (reg >= value) {
+            return false;
+        }
+        registerHistogram[reg & (HISTOGRAM_SIZE - 1)]--;
+        registerHistogram[value & (HISTOGRAM_SIZE - 1)]++;
+        reg = value;
+        hasCachedEstimate = false;
+        return true;
+    }
+
+    // Switches to dense mode over a full register array and counts it once.
+    void adoptRegisters(std::vector<uint8_t>& registers) {
+        buckets.swap(registers);
+        registerHistogram.assign(HISTOGRAM_SIZE, 0);
+        for (int i = 0; i < K; ++i) {
+            registerHistogram[buckets[i] & (HISTOGRAM_SIZE - 1)]++;
+        }
+        numNonZero = K - registerHistogram[0];
+        isDenseMode = true;
+        hasCachedEstimate = false;
+        std::vector<uint32_t>().swap(coupons);
+    }
+
+    bool sparseUpdate(uint32_t slotNo, uint8_t value) {
+        bool changed = sparseInsert(slotNo, value);
+        if (changed) {
+            hasCachedEstimate = false;
+        }
+        if (numNonZero > K / 16) {
+            toDense();
+        }
+        return changed;
+    }
+
+    // Adds a register given with lg bits of slot; while sparse, lg must be at
+    // least sparseLgK (see reduceSparsePrecision).
+    void addRegister(uint32_t slotNo, uint8_t value, int lg) {
+        int target = isDenseMode ? LgK : sparseLgK;
+        if (lg > target) {
+            uint32_t folded = foldCoupon(slotNo, value, lg, target);
+            slotNo = folded >> VALUE_BITS;
+            value = folded & VALUE_MASK;
+        }
+        if (!isDenseMode) {
+            sparseUpdate(slotNo, value);
+        } else {
+            raiseRegister(slotNo, value);
+        }
+    }
+
+    // Folds the sparse coupons down to lg bits of slot, so that registers
+    // which are only known at that precision can be merged in.
+    void reduceSparsePrecision(int lg) {
+        if (isDenseMode || lg >= sparseLgK) {
+            return;
+        }
+        int oldLgK = sparseLgK;
+        sparseLgK = lg;
+        if (numNonZero == 0) {
+            return;
+        }
+        std::vector<uint32_t> old;
+        old.swap(coupons);
+        reserveCoupons(numNonZero);
+        numNonZero = 0;
+        for (uint32_t coupon : old) {
+            if (coupon != 0) {
+                uint32_t folded = foldCoupon(coupon >> VALUE_BITS, coupon & VALUE_MASK, oldLgK, lg);
+                sparseInsert(folded >> VALUE_BITS, folded & VALUE_MASK);
+            }
+        }
+        hasCachedEstimate = false;
+        syncBudget();
+    }
+
+    // Merges a register known only at LgK precision (DataSketches input).
+    void mergeRegister(uint32_t slotNo, uint8_t value) {
+        reduceSparsePrecision(LgK);
+        addRegister(slotNo, value, LgK);
+    }
+
+    // Register-wise max for a dense destination. Blocks of registers the
+    // other sketch does not raise are skipped in bulk; only raised registers
+    // touch the histogram.
+    void mergeDense(const uint8_t* other) {
+        int i = 0;
+#ifdef __wasm_simd128__
+        for (; i + 16 <= K; i += 16) {
+            v128_t mine = wasm_v128_load(&buckets[i]);
+            v128_t merged = wasm_u8x16_max(mine, wasm_v128_load(&other[i]));
+            if (!wasm_i8x16_all_true(wasm_i8x16_eq(mine, merged))) {
+                for (int j = i; j < i + 16; ++j) {
+                    raiseRegister(j, other[j]);
+                }
+            }
+        }
+#endif
+        for (; i < K; ++i) {
+            raiseRegister(i, other[i]);
+        }
+    }
+
+    // Extended preamble (CACHED_SER_VER_BYTE): the estimate as a raw double,
+    // followed by the register-value histogram as a length byte and varints.
+    void writePreamble(std::vector<uint8_t>& result, uint8_t flags, bool withCache) const {
+        if (reducedPrecision) flags |= REDUCED_PRECISION_FLAG_MASK;
+        bool highPrecision = isHighPrecisionSparse();
+        result.push_back(withCache ? CACHED_PREAMBLE_INTS_BYTE : PREAMBLE_INTS_BYTE);
+        if (highPrecision) {
+            result.push_back(withCache ? CACHED_SPARSE_SER_VER_BYTE : SPARSE_SER_VER_BYTE);
+        } else {
+            result.push_back(withCache ? CACHED_SER_VER_BYTE : SER_VER_BYTE);
+        }
+        result.push_back(FAMILY_BYTE);
+        result.push_back(flags);
+        result.push_back(static_cast<uint8_t>(LgK));
+        if (highPrecision) {
+            result.push_back(static_cast<uint8_t>(sparseLgK));
+        }
+
+        if (!withCache) {
+            return;
+        }
+
+        uint32_t histogram[HISTOGRAM_SIZE];
+        computeHistogram(histogram);
+        double estimate_value = hasCachedEstimate ? cachedEstimate
+                              : highPrecision ? estimateSparse(sparseLgK, static_cast<uint32_t>(numNonZero))
+                                              : estimateFromHistogram(K, histogram);
+
+        uint8_t estimateBytes[sizeof(double)];
+        memcpy(estimateBytes, &estimate_value, sizeof(double));
+        result.insert(result.end(), estimateBytes, estimateBytes + sizeof(double));
+
+        int histogramLen = HISTOGRAM_SIZE;
+        while (histogramLen > 1 && histogram[histogramLen - 1] == 0) {
+            histogramLen--;
+        }
+        result.push_back(static_cast<uint8_t>(histogramLen));
+        for (int i = 0; i < histogramLen; ++i) {
+            writeVarInt(result, histogram[i]);
+        }
+    }
+
+public:
+    Sketch() : sparseLgK(SPARSE_LG_K),
+               numNonZero(0),
+               isDenseMode(false),
+               hasCachedEstimate(false),
+               cachedEstimate(0.0) {}
+
+    int lgK() const override { return LgK; }
+    bool isDense() const override { return isDenseMode; }
+
+    bool isEmpty() const override {
+        if (!isDenseMode) {
+            return numNonZero == 0;
+        }
+        return registerHistogram[0] == static_cast<uint32_t>(K);
+    }
+
+    size_t memoryUsage() const override {
+        return sizeof(*this) + coupons.capacity() * sizeof(uint32_t) + buckets.capacity() +
+               registerHistogram.capacity() * sizeof(uint32_t);
+    }
+
+    // The register array; only populated in dense mode.
+    const uint8_t* registers() const { return isDenseMode ? buckets.data() : nullptr; }
+
+    std::unique_ptr<SketchBase> clone() const override {
+        return std::make_unique<Sketch>(*this);
+    }
+
+    void updateWithHash(uint64_t hashValue) override {
+        HLL_COUNT(updates, 1);
+        if (!isDenseMode) {
+            uint32_t slotNo = hashValue >> (64 - sparseLgK);
+            uint64_t w = hashValue << sparseLgK;
+            int rank = std::min(static_cast<int>(__builtin_clzll(w) + 1), 64 - sparseLgK + 1);
+            if (sparseUpdate(slotNo, static_cast<uint8_t>(rank))) {
+                HLL_COUNT(registerChanges, 1);
+            }
+            return;
+        }
+        int slotNo = hashValue >> (64 - LgK);
+        uint64_t w = hashValue << LgK;
+        uint8_t rank = std::min(static_cast<int>(__builtin_clzll(w) + 1), 64 - LgK + 1);
+        if (raiseRegister(slotNo, rank)) {
+            HLL_COUNT(registerChanges, 1);
+        }
+    }
+
+    void updateDelimited(const uint8_t* data, size_t len,
+                         const uint8_t* delimiter, size_t delimiterLen) override {
+        forEachDelimited(data, len, delimiter, delimiterLen, [this](const uint8_t* key, size_t keyLen) {
+            updateWithHash(hash(key, keyLen));
+        });
+    }
+
+    bool updateJsonArray(const char* data, size_t len) override {
+        std::vector<uint64_t> hashes;
+        bool valid = forEachJsonArrayElement(data, len, [&hashes](const uint8_t* key, size_t keyLen) {
+            if (keyLen > 0) hashes.push_back(hash(key, keyLen));
+        });
+        if (!valid) {
+            return false;
+        }
+        for (uint64_t h : hashes) {
+            updateWithHash(h);
+        }
+        return true;
+    }
+
+    void toDense() override {
+        if (!isDenseMode) {
+            std::vector<uint8_t> registers;
+            denseRegisters(registers);
+            adoptRegisters(registers);
+            syncBudget();
+            HLL_COUNT(densePromotions, 1);
+        }
+    }
+
+    void computeHistogram(uint32_t* histogram) const override {
+        std::fill(histogram, histogram + HISTOGRAM_SIZE, 0);
+        if (isHighPrecisionSparse()) {
+            std::vector<uint8_t> scratch;
+            const uint8_t* registers = denseRegisters(scratch);
+            for (int i = 0; i < K; ++i) {
+                histogram[registers[i] & (HISTOGRAM_SIZE - 1)]++;
+            }
+            return;
+        }
+        if (!isDenseMode) {
+            histogram[0] = static_cast<uint32_t>(K - numNonZero);
+            for (uint32_t coupon : coupons) {
+                if (coupon != 0) {
+                    histogram[(coupon & VALUE_MASK) & (HISTOGRAM_SIZE - 1)]++;
+                }
+            }
+            return;
+        }
+        std::copy(registerHistogram.begin(), registerHistogram.end(), histogram);
+    }
+
+    double estimate() const override {
+        if (hasCachedEstimate) {
+            return cachedEstimate;
+        }
+        if (isHighPrecisionSparse()) {
+            return estimateSparse(sparseLgK, static_cast<uint32_t>(numNonZero));
+        }
+        if (isDenseMode) {
+            return estimateFromHistogram(K, registerHistogram.data());
+        }
+        uint32_t histogram[HISTOGRAM_SIZE];
+        computeHistogram(histogram);
+        return estimateFromHistogram(K, histogram);
+    }
+
+    int registerLgK() const override { return isDenseMode ? LgK : sparseLgK; }
+
+    void forEachRegister(const std::function<void(uint32_t, uint8_t)>& f) const override {
+        if (!isDenseMode) {
+            for (uint32_t coupon : coupons) {
+                if (coupon != 0) {
+                    f(coupon >> VALUE_BITS, coupon & VALUE_MASK);
+                }
+            }
+            return;
+        }
+        for (int i = 0; i < K; ++i) {
+            if (buckets[i] != 0) {
+                f(i, buckets[i]);
+            }
+        }
+    }
+
+    void merge(const SketchBase& other) override {
+        if (other.lgK() < LgK) return;
+        reducedPrecision |= other.isReducedPrecision();
+
+        if (other.lgK() == LgK && other.isDense()) {
+            HLL_COUNT(mergesDense, 1);
+            if (!isDenseMode) toDense();
+            mergeDense(static_cast<const Sketch&>(other).buckets.data());
+            return;
+        }
+        int otherLgK = other.registerLgK();
+        reduceSparsePrecision(otherLgK);
+        if (other.lgK() != LgK) {
+            HLL_COUNT(mergesFolded, 1);
+            other.forEachRegister([this, otherLgK](uint32_t slotNo, uint8_t value) {
+                addRegister(slotNo, value, otherLgK);
+            });
+            return;
+        }
+        HLL_COUNT(mergesSparse, 1);
+        const Sketch& source = static_cast<const Sketch&>(other);
+        for (uint32_t coupon : source.coupons) {
+            if (coupon != 0) {
+                addRegister(coupon >> VALUE_BITS, coupon & VALUE_MASK, otherLgK);
+            }
+        }
+    }
+
+    std::unique_ptr<SketchBase> foldTo(int targetLgK) const override {
+        std::unique_ptr<SketchBase> folded = makeSketch(std::min(targetLgK, LgK));
+        folded->merge(*this);
+        if (folded->lgK() < LgK || reducedPrecision) {
+            folded->markReducedPrecision();
+        }
+        return folded;
+    }
+
+    bool mergeDataSketches(const uint8_t* data, size_t len) override {
+        if (!isDataSketchesBlob(data, len) || data[1] != DS_SER_VER_BYTE) {
+            return false;
+        }
+        uint8_t preInts = data[0] & 0x3F;
+        int srcLgK = data[3];
+        int lgArr = data[4];
+        uint8_t flags = data[5];
+        int curMode = data[7] & 3;
+        int tgtHllType = (data[7] >> 2) & 3;
+
+        // lgArr sizes the coupon or aux table; neither can outgrow the sketch.
+        if (srcLgK < MIN_LG_K || srcLgK > MAX_LG_K || srcLgK < LgK || tgtHllType > 2 ||
+            lgArr > srcLgK + 1) {
+            return false;
+        }
+        if (flags & DS_EMPTY_FLAG_MASK) {
+            return true;
+        }
+
+        bool isCompact = (flags & COMPACT_FLAG_MASK) != 0;
+        constexpr uint32_t slotMask = K - 1;
+
+        if (curMode == DS_MODE_LIST || curMode == DS_MODE_SET) {
+            size_t start;
+            size_t count;
+            if (curMode == DS_MODE_LIST) {
+                if (preInts != DS_LIST_PREINTS) return false;
+                start = DS_LIST_INT_ARR_START;
+                count = isCompact ? data[6] : (size_t(1) << lgArr);
+            } else {
+                // A coupon set is promoted to HLL mode before it reaches K/8 slots.
+                if (preInts != DS_SET_PREINTS || len < DS_SET_INT_ARR_START || lgArr >= srcLgK) return false;
+                start = DS_SET_INT_ARR_START;
+                count = isCompact ? readLE32(data + 8) : (size_t(1) << lgArr);
+            }
+            if (count > (len - start) / sizeof(uint32_t)) {
+                return false;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                uint32_t coupon = readLE32(data + start + i * sizeof(uint32_t));
+                if (coupon != 0) {
+                    mergeRegister(coupon & slotMask, coupon >> DS_KEY_BITS);
+                }
+            }
+            HLL_COUNT(mergesDataSketches, 1);
+            return true;
+        }
+
+        if (curMode != DS_MODE_HLL || preInts != DS_HLL_PREINTS) {
+            return false;
+        }
+
+        int srcK = 1 << srcLgK;
+        size_t arrBytes = dsHllArrayBytes(tgtHllType, srcLgK);
+        if (len < DS_HLL_BYTE_ARR_START + arrBytes) {
+            return false;
+        }
+        const uint8_t* arr = data + DS_HLL_BYTE_ARR_START;
+
+        if (tgtHllType == 2) {
+            for (int i = 0; i < srcK; ++i) {
+                if (arr[i] != 0) {
+                    mergeRegister(i & slotMask, arr[i]);
+                }
+            }
+        } else if (tgtHllType == 1) {
+            for (int i = 0; i < srcK; ++i) {
+                uint32_t startBit = i * 6;
+                uint32_t byteIdx = startBit >> 3;
+                uint16_t twoBytes = arr[byteIdx] | (arr[byteIdx + 1] << 8);
+                uint8_t value = (twoBytes >> (startBit & 7)) & 0x3F;
+                if (value != 0) {
+                    mergeRegister(i & slotMask, value);
+                }
+            }
+        } else {
+            uint8_t curMin = data[6];
+            uint32_t auxCount = readLE32(data + 36);
+            size_t auxStart = DS_HLL_BYTE_ARR_START + arrBytes;
+            size_t auxInts = isCompact ? auxCount : (auxCount > 0 ? (size_t(1) << lgArr) : 0);
+            if (auxInts > (len - auxStart) / sizeof(uint32_t)) {
+                return false;
+            }
+            for (int i = 0; i < srcK; ++i) {
+                uint8_t nibble = (i & 1) ? (arr[i >> 1] >> 4) : (arr[i >> 1] & 0x0F);
+                if (nibble != DS_AUX_TOKEN && nibble + curMin != 0) {
+                    mergeRegister(i & slotMask, nibble + curMin);
+                }
+            }
+            for (size_t i = 0; i < auxInts; ++i) {
+                uint32_t pair = readLE32(data + auxStart + i * sizeof(uint32_t));
+                if (pair != 0) {
+                    mergeRegister(pair & slotMask, pair >> DS_KEY_BITS);
+                }
+            }
+        }
+        HLL_COUNT(mergesDataSketches, 1);
+        return true;
+    }
+
+    bool applyDelta(const uint8_t* data, size_t len) override {
+        if (!isDeltaBlob(data, len) || data[3] < LgK ||
+            !forEachDeltaRegister(data, len, [](uint32_t, uint8_t) {})) {
+            return false;
+        }
+        int lg = data[3];
+        reducedPrecision |= (data[2] & REDUCED_PRECISION_FLAG_MASK) != 0;
+        // Rebuilding a dense snapshot from a sparse base must end up dense.
+        if (data[1] == LgK && (data[2] & FULL_SIZE_FLAG_MASK) != 0) {
+            toDense();
+        }
+        reduceSparsePrecision(lg);
+        forEachDeltaRegister(data, len, [this, lg](uint32_t slotNo, uint8_t value) {
+            addRegister(slotNo, value, lg);
+        });
+        HLL_COUNT(mergesDelta, 1);
+        return true;
+    }
+
+    std::vector<uint8_t> serialize(bool withCache = false) const override {
+        std::vector<uint8_t> result;
+        result.reserve(isDenseMode ? 5 + K : 5 + 3 * numNonZero);
+
+        uint8_t flags = 0;
+        if (isDenseMode) flags |= FULL_SIZE_FLAG_MASK;
+        writePreamble(result, flags, withCache);
+
+        if (!isDenseMode) {
+            writeVarInt(result, static_cast<uint32_t>(numNonZero));
+
+            for (uint32_t coupon : sortedCoupons()) {
+                writeVarInt(result, coupon >> VALUE_BITS);
+                result.push_back(static_cast<uint8_t>(coupon & VALUE_MASK));
+            }
+        } else {
+            result.insert(result.end(), buckets.begin(), buckets.end());
+        }
+        HLL_COUNT(bytesStandard, result.size());
+        return result;
+    }
+
+    std::vector<uint8_t> serialize_compact(bool withCache = false) const override {
+        std::vector<uint8_t> result;
+        result.reserve(8);
+
+        uint8_t flags = 0;
+        if (isDenseMode) flags |= FULL_SIZE_FLAG_MASK;
+        flags |= COMPACT_FLAG_MASK;
+        writePreamble(result, flags, withCache);
+
+        if (!isDenseMode) {
+            writeVarInt(result, static_cast<uint32_t>(numNonZero));
+
+            // A coupon is (slot << VALUE_BITS) | value, so sorting them sorts by
+            // slot. High-precision coupons are large, so they are delta-encoded.
+            bool highPrecision = isHighPrecisionSparse();
+            uint32_t previous = 0;
+            for (uint32_t coupon : sortedCoupons()) {
+                writeVarInt(result, highPrecision ? coupon - previous : coupon);
+                previous = coupon;
+            }
+        } else {
+            constexpr size_t numBytes = (K * VALUE_BITS + 7) / 8;
+            size_t currentSize = result.size();
+            result.resize(currentSize + numBytes, 0);
+
+            packBits(buckets.data(), result.data() + currentSize, K, VALUE_BITS);
+        }
+
+        HLL_COUNT(bytesCompact, result.size());
+        return result;
+    }
+
+    std::vector<uint8_t> serialize_datasketches(int tgtHllType) const override {
+        uint32_t histogram[HISTOGRAM_SIZE];
+        computeHistogram(histogram);
+
+        if (histogram[0] == static_cast<uint32_t>(K)) {
+            std::vector<uint8_t> result(DS_LIST_INT_ARR_START, 0);
+            result[0] = DS_LIST_PREINTS;
+            result[1] = DS_SER_VER_BYTE;
+            result[2] = DS_FAMILY_BYTE;
+            result[3] = static_cast<uint8_t>(LgK);
+            result[4] = 3;
+            result[5] = DS_EMPTY_FLAG_MASK | COMPACT_FLAG_MASK;
+            result[7] = static_cast<uint8_t>(DS_MODE_LIST | (tgtHllType << 2));
+            HLL_COUNT(bytesDataSketches, result.size());
+            return result;
+        }
+
+        double kxq0 = 0.0;
+        double kxq1 = 0.0;
+        for (int v = 0; v < HISTOGRAM_SIZE; ++v) {
+            (v < 32 ? kxq0 : kxq1) += histogram[v] * invPow2Table[v];
+        }
+        int curMin = 0;
+        if (tgtHllType == 0) {
+            while (histogram[curMin] == 0) curMin++;
+        }
+        uint32_t numAtCurMin = histogram[curMin];
+
+        std::vector<uint8_t> scratch;
+        const uint8_t* regs = denseRegisters(scratch);
+
+        std::vector<uint32_t> aux;
+        if (tgtHllType == 0) {
+            for (int i = 0; i < K; ++i) {
+                if (regs[i] - curMin >= DS_AUX_TOKEN) {
+                    aux.push_back((static_cast<uint32_t>(regs[i]) << DS_KEY_BITS) | i);
+                }
+            }
+        }
+        int lgAuxArrInts = tgtHllType == 0 ? DS_LG_AUX_ARR_INTS[LgK] : 0;
+        while (tgtHllType == 0 && 4 * aux.size() > 3 * (size_t(1) << lgAuxArrInts)) {
+            lgAuxArrInts++;
+        }
+
+        size_t arrBytes = dsHllArrayBytes(tgtHllType, LgK);
+        std::vector<uint8_t> result(DS_HLL_BYTE_ARR_START + arrBytes + aux.size() * sizeof(uint32_t), 0);
+        result[0] = DS_HLL_PREINTS;
+        result[1] = DS_SER_VER_BYTE;
+        result[2] = DS_FAMILY_BYTE;
+        result[3] = static_cast<uint8_t>(LgK);
+        result[4] = static_cast<uint8_t>(lgAuxArrInts);
+        result[5] = COMPACT_FLAG_MASK | DS_OUT_OF_ORDER_FLAG_MASK;
+        result[6] = static_cast<uint8_t>(curMin);
+        result[7] = static_cast<uint8_t>(DS_MODE_HLL | (tgtHllType << 2));
+
+        double hipAccum = estimate();
+        memcpy(&result[8], &hipAccum, sizeof(double));
+        memcpy(&result[16], &kxq0, sizeof(double));
+        memcpy(&result[24], &kxq1, sizeof(double));
+        writeLE32(&result[32], numAtCurMin);
+        writeLE32(&result[36], static_cast<uint32_t>(aux.size()));
+
+        uint8_t* arr = &result[DS_HLL_BYTE_ARR_START];
+        for (int i = 0; i < K; ++i) {
+            uint8_t value = regs[i];
+            if (tgtHllType == 2) {
+                arr[i] = value;
+            } else if (tgtHllType == 1) {
+                uint32_t startBit = i * 6;
+                uint32_t byteIdx = startBit >> 3;
+                uint16_t bits = static_cast<uint16_t>((value & 0x3F) << (startBit & 7));
+                arr[byteIdx] |= bits & 0xFF;
+                arr[byteIdx + 1] |= bits >> 8;
+            } else {
+                uint8_t nibble = static_cast<uint8_t>(std::min(value - curMin, DS_AUX_TOKEN));
+                arr[i >> 1] |= (i & 1) ? (nibble << 4) : nibble;
+            }
+        }
+        for (size_t i = 0; i < aux.size(); ++i) {
+            writeLE32(&result[DS_HLL_BYTE_ARR_START + arrBytes + i * sizeof(uint32_t)], aux[i]);
+        }
+        HLL_COUNT(bytesDataSketches, result.size());
+        return result;
+    }
+
+    std::string toString() const override {
+        std::ostringstream oss;
+        oss << "HyperLogLog Sketch:\n  LgK: " << LgK << "\n  K: " << K
+            << "\n  Mode: " << (isDenseMode ? "Dense" : "Sparse")
+            << "\n  Estimated cardinality: " << std::llround(estimate());
+        if (reducedPrecision) {
+            oss << "\n  Reduced precision: yes";
+        }
+        return oss.str();
+    }
+
+    bool load(const Header& header, const uint8_t* data, size_t len, size_t offset) override {
+        isDenseMode = header.isDense;
+        reducedPrecision = header.isReducedPrecision;
+        sparseLgK = header.sparseLgK;
+        uint32_t sparseK = 1u << sparseLgK;
+
+        if (header.isCached) {
+            uint32_t histogram[HISTOGRAM_SIZE];
+            size_t estimateOffset = offset;
+            if (!readCachedHistogram(data, len, offset, histogram)) {
+                return false;
+            }
+            memcpy(&cachedEstimate, data + estimateOffset, sizeof(double));
+            uint64_t total = 0;
+            for (int i = 0; i < HISTOGRAM_SIZE; ++i) {
+                total += histogram[i];
+            }
+            if (total != static_cast<uint64_t>(K)) {
+                return false;
+            }
+            // Dense blobs carry no count of their own; take it from the histogram.
+            numNonZero = K - histogram[0];
+        }
+
+        if (!header.isDense) {
+            uint32_t count;
+            if (!readVarInt(data, len, offset, count)) {
+                return false;
+            }
+            numNonZero = 0;
+            // Larger values cannot come from a hash and would overflow the
+            // coupon's value bits once folded down to lgK.
+            int maxValue = 64 - sparseLgK + 1;
+
+            if (header.isCompact) {
+                bool deltas = sparseLgK > LgK;
+                uint32_t previous = 0;
+                for (uint32_t i = 0; i < count; ++i) {
+                    uint32_t pair;
+                    if (!readVarInt(data, len, offset, pair)) {
+                        return false;
+                    }
+                    if (deltas) {
+                        pair += previous;
+                        previous = pair;
+                    }
+                    uint32_t index = pair >> VALUE_BITS;
+                    uint8_t value = pair & ((1 << VALUE_BITS) - 1);
+
+                    if (index >= sparseK || value > maxValue) {
+                        return false;
+                    }
+                    if (value != 0) sparseInsert(index, value);
+                }
+            } else {
+                while (offset < len) {
+                    uint32_t index;
+                    if (!readVarInt(data, len, offset, index)) {
+                        return false;
+                    }
+
+                    if (offset >= len) {
+                        return false;
+                    }
+
+                    uint8_t value = data[offset++];
+
+                    if (index >= sparseK || value > maxValue) {
+                        return false;
+                    }
+
+                    if (value != 0) sparseInsert(index, value);
+                }
+            }
+        } else {
+            std::vector<uint8_t> registers(K, 0);
+            if (header.isCompact) {
+                if (!unpackBits(data + offset, len - offset, registers.data(), K, VALUE_BITS)) {
+                    return false;
+                }
+            } else {
+                if (len != offset + K) {
+                    return false;
+                }
+                memcpy(registers.data(), data + offset, K);
+            }
+            adoptRegisters(registers);
+        }
+
+        // Set last, since adoptRegisters drops any cached estimate.
+        hasCachedEstimate = header.isCached;
+        syncBudget();
+        return true;
+    }
+
+    std::vector<uint8_t> serializeState() const override {
+        std::vector<uint8_t> result;
+        uint8_t flags = 0;
+        if (isDenseMode) flags |= FULL_SIZE_FLAG_MASK;
+        if (reducedPrecision) flags |= REDUCED_PRECISION_FLAG_MASK;
+
+        if (isDenseMode) {
+            result.resize(STATE_HEADER_BYTES + K);
+            memcpy(result.data() + STATE_HEADER_BYTES, buckets.data(), K);
+        } else {
+            result.reserve(STATE_HEADER_BYTES + 6 + 5 * numNonZero);
+            result.resize(STATE_HEADER_BYTES);
+            result.push_back(static_cast<uint8_t>(sparseLgK));
+            writeVarInt(result, static_cast<uint32_t>(numNonZero));
+            uint32_t nextSlot = 0;
+            for (uint32_t coupon : sortedCoupons()) {
+                uint32_t slotNo = coupon >> VALUE_BITS;
+                writeVarInt(result, slotNo - nextSlot);
+                result.push_back(static_cast<uint8_t>(coupon & VALUE_MASK));
+                nextSlot = slotNo + 1;
+            }
+        }
+        result[0] = STATE_FORMAT_BYTE;
+        result[1] = static_cast<uint8_t>(LgK);
+        result[2] = flags;
+        HLL_COUNT(bytesState, result.size());
+        return result;
+    }
+
+    bool loadState(const uint8_t* data, size_t len) override {
+        reducedPrecision = (data[2] & REDUCED_PRECISION_FLAG_MASK) != 0;
+        size_t offset = STATE_HEADER_BYTES;
+
+        if ((data[2] & FULL_SIZE_FLAG_MASK) != 0) {
+            if (len != offset + K) {
+                return false;
+            }
+            std::vector<uint8_t> registers(data + offset, data + offset + K);
+            adoptRegisters(registers);
+        } else {
+            uint32_t count;
+            if (offset >= len) {
+                return false;
+            }
+            sparseLgK = data[offset++];
+            if (sparseLgK < LgK || sparseLgK > SPARSE_LG_K ||
+                !readVarInt(data, len, offset, count) || count > static_cast<uint32_t>(K)) {
+                return false;
+            }
+            reserveCoupons(count);
+            uint32_t slotNo = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                uint32_t zeros;
+                if (!readVarInt(data, len, offset, zeros) || offset >= len) {
+                    return false;
+                }
+                slotNo += zeros;
+                if (slotNo >= (1u << sparseLgK) || data[offset] == 0 || data[offset] > 64 - sparseLgK + 1) {
+                    return false;
+                }
+                coupons[findCoupon(slotNo)] = (slotNo << VALUE_BITS) | data[offset++];
+                slotNo++;
+            }
+            numNonZero = count;
+        }
+        syncBudget();
+        return true;
+    }
+};
+
+// Dense sketch that many threads can update at once. Each register is raised
+// with a compare-and-swap fetch-max, and the non-zero count is a relaxed
+// counter, so updates never take a lock. Once a register has reached its value,
+// later updates to it are a plain load. snapshot() produces an ordinary
+// Sketch<LgK>; once more than K/16 registers are set it is dense and
+// serializes byte-identically to a sequential sketch fed the same hashes.
+// Smaller snapshots are sparse at lgK precision, since the high-precision
+// coupons were never recorded.
+template <int LgK>
+class ConcurrentSketch {
+    static_assert(LgK >= MIN_LG_K && LgK <= MAX_LG_K, "lgK out of range");
+    static_assert(std::atomic<uint8_t>::is_always_lock_free, "byte atomics must be lock-free");
+
+public:
+    static constexpr int K = 1 << LgK;
+
+private:
+    std::array<std::atomic<uint8_t>, K> buckets;
+    std::atomic<int64_t> numNonZero;
+
+public:
+    ConcurrentSketch() : numNonZero(0) {
+        for (std::atomic<uint8_t>& bucket : buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    ConcurrentSketch(const ConcurrentSketch&) = delete;
+    ConcurrentSketch& operator=(const ConcurrentSketch&) = delete;
+
+    int lgK() const { return LgK; }
+
+    void updateWithHash(uint64_t hashValue) {
+        int slotNo = hashValue >> (64 - LgK);
+        uint64_t w = hashValue << LgK;
+        uint8_t rank = static_cast<uint8_t>(
+            std::min(static_cast<int>(__builtin_clzll(w) + 1), 64 - LgK + 1));
+
+        std::atomic<uint8_t>& bucket = buckets[slotNo];
+        uint8_t current = bucket.load(std::memory_order_relaxed);
+        while (current < rank) {
+            if (bucket.compare_exchange_weak(current, rank, std::memory_order_relaxed)) {
+                if (current == 0) {
+                    numNonZero.fetch_add(1, std::memory_order_relaxed);
+                }
+                return;
+            }
+        }
+    }
+
+    void update(const uint8_t* key, size_t len) {
+        if (key == nullptr || len == 0) {
+            return;
+        }
+        updateWithHash(hash(key, len));
+    }
+
+    int64_t nonZeroCount() const {
+        return numNonZero.load(std::memory_order_relaxed);
+    }
+
+    // Copies the registers into a regular sketch. Updates racing with the
+    // snapshot may or may not be included, as with any relaxed read.
+    std::unique_ptr<Sketch<LgK>> snapshot() const {
+        std::unique_ptr<Sketch<LgK>> sketch = std::make_unique<Sketch<LgK>>();
+        std::vector<uint8_t> registers(K);
+        int64_t count = 0;
+        for (int i = 0; i < K; ++i) {
+            registers[i] = buckets[i].load(std::memory_order_relaxed);
+            count += registers[i] != 0;
+        }
+        if (count > K / 16) {
+            sketch->adoptRegisters(registers);
+        } else {
+            sketch->sparseLgK = LgK;
+            for (int i = 0; i < K; ++i) {
+                if (registers[i] != 0) {
+                    sketch->sparseInsert(i, registers[i]);
+                }
+            }
+        }
+        return sketch;
+    }
+
+    std::vector<uint8_t> serialize() const { return snapshot()->serialize(); }
+    std::vector<uint8_t> serialize_compact() const { return snapshot()->serialize_compact(); }
+};
+
+inline std::unique_ptr<SketchBase> makeSketch(int lgK) {
+    return dispatchLgK(lgK, [](auto lg) -> std::unique_ptr<SketchBase> {
+        return std::make_unique<Sketch<decltype(lg)::value>>();
+    });
+}
+
+// Returns nullptr when the buffer is not a valid sketch in this library's format.
+inline std::unique_ptr<SketchBase> deserialize(const uint8_t* data, size_t len) {
+    Header header;
+    size_t offset;
+    if (!parseHeader(data, len, header, offset)) {
+        HLL_COUNT(rejectedInputs, 1);
+        return nullptr;
+    }
+    std::unique_ptr<SketchBase> sketch = makeSketch(header.lgK);
+    if (!sketch->load(header, data, len, offset)) {
+        HLL_COUNT(rejectedInputs, 1);
+        return nullptr;
+    }
+    return sketch;
+}
+
+// Counterpart of SketchBase::serializeState(); nullptr when the buffer is not
+// a state image.
+inline std::unique_ptr<SketchBase> deserializeState(const uint8_t* data, size_t len) {
+    if (data == nullptr || len < STATE_HEADER_BYTES || data[0] != STATE_FORMAT_BYTE ||
+        data[1] < MIN_LG_K || data[1] > MAX_LG_K) {
+        HLL_COUNT(rejectedInputs, 1);
+        return nullptr;
+    }
+    std::unique_ptr<SketchBase> sketch = makeSketch(data[1]);
+    if (!sketch->loadState(data, len)) {
+        HLL_COUNT(rejectedInputs, 1);
+        return nullptr;
+    }
+    return sketch;
+}
+
+// The non-zero registers of a sketch folded to lg bits of slot (at most
+// registerLgK()), as coupons in slot order with one per slot.
+inline std::vector<uint32_t> foldedCoupons(const SketchBase& sketch, int lg) {
+    std::vector<uint32_t> coupons;
+    int fromLgK = sketch.registerLgK();
+    sketch.forEachRegister([&coupons, fromLgK, lg](uint32_t slotNo, uint8_t value) {
+        coupons.push_back(foldCoupon(slotNo, value, fromLgK, lg));
+    });
+    std::sort(coupons.begin(), coupons.end());
+    size_t kept = 0;
+    for (size_t i = 0; i < coupons.size(); ++i) {
+        if (i + 1 < coupons.size() && (coupons[i + 1] >> VALUE_BITS) == (coupons[i] >> VALUE_BITS)) {
+            continue;
+        }
+        coupons[kept++] = coupons[i];
+    }
+    coupons.resize(kept);
+    return coupons;
+}
+
+// Encodes the registers newer holds above base (see DELTA_FORMAT_BYTE), at the
+// lower coupon precision of the two. layoutFlags take COMPACT_FLAG_MASK and
+// DELTA_CACHED_FLAG_MASK of the newer blob. Returns an empty vector when the
+// lgK differ or some register of base is larger than in newer.
+inline std::vector<uint8_t> encodeDelta(const SketchBase& base, const SketchBase& newer,
+                                        uint8_t layoutFlags) {
+    if (base.lgK() != newer.lgK()) {
+        return {};
+    }
+    constexpr uint32_t valueMask = (1 << VALUE_BITS) - 1;
+    int lg = std::min(base.registerLgK(), newer.registerLgK());
+    std::vector<uint32_t> baseCoupons = foldedCoupons(base, lg);
+    std::vector<uint32_t> raised;
+    size_t j = 0;
+    for (uint32_t coupon : foldedCoupons(newer, lg)) {
+        uint32_t slotNo = coupon >> VALUE_BITS;
+        uint32_t baseValue = 0;
+        if (j < baseCoupons.size() && (baseCoupons[j] >> VALUE_BITS) < slotNo) {
+            return {};
+        }
+        if (j < baseCoupons.size() && (baseCoupons[j] >> VALUE_BITS) == slotNo) {
+            baseValue = baseCoupons[j++] & valueMask;
+        }
+        if ((coupon & valueMask) < baseValue) {
+            return {};
+        }
+        if ((coupon & valueMask) > baseValue) {
+            raised.push_back(coupon);
+        }
+    }
+    if (j != baseCoupons.size()) {
+        return {};
+    }
+
+    uint8_t flags = layoutFlags & (COMPACT_FLAG_MASK | DELTA_CACHED_FLAG_MASK);
+    if (newer.isDense()) flags |= FULL_SIZE_FLAG_MASK;
+    if (newer.isReducedPrecision()) flags |= REDUCED_PRECISION_FLAG_MASK;
+    std::vector<uint8_t> result = {DELTA_FORMAT_BYTE, static_cast<uint8_t>(newer.lgK()), flags,
+                                   static_cast<uint8_t>(lg)};
+    result.reserve(DELTA_HEADER_BYTES + 5 + 3 * raised.size());
+    writeVarInt(result, static_cast<uint32_t>(raised.size()));
+    uint32_t nextSlot = 0;
+    for (uint32_t coupon : raised) {
+        uint32_t slotNo = coupon >> VALUE_BITS;
+        writeVarInt(result, slotNo - nextSlot);
+        result.push_back(static_cast<uint8_t>(coupon & valueMask));
+        nextSlot = slotNo + 1;
+    }
+    return result;
+}
+
+} // namespace hll
+
+#endif
@@ -0,0 +1,98 @@
+// Reduced-precision bookkeeping: memory-budgeted aggregates, folds on
+// union and copies of folded sketches.
+#include "test_util.h"
+
+using namespace hll_test;
+
+namespace {
+
+extension_state_t addBudgeted(extension_state_t state, int from, int to, int lgK, int64_t budget) {
+    for (int i = from; i < to; ++i) {
+        std::string k = key(i);
+        extension_list_u8_t in{reinterpret_cast<uint8_t*>(k.data()), k.size()};
+        state = extension_hll_add_budgeted(state, &in, lgK, budget);
+    }
+    return state;
+}
+
+} // namespace
+
+TEST_CASE(testCloneKeepsReducedPrecision) {
+    hll::MemoryBudget budget;
+    std::unique_ptr<SketchBase> folded = sketchOf(14, 0, 20000)->foldTo(10);
+    folded->attachBudget(&budget);
+    std::unique_ptr<SketchBase> copy = folded->clone();
+    CHECK(copy->isReducedPrecision());
+    CHECK(budget.used == folded->memoryUsage());
+    CHECK(copy->serialize() == folded->serialize());
+}
+
+TEST_CASE(testUnionMergeKeepsPrecision) {
+    // Every aggregate starts from hll_empty (lgK 12); an lgK 16 partial state
+    // must survive the merge with it.
+    SketchBase* partial = sketchOf(16, 0, 20000).release();
+    Bytes expected = partial->serialize();
+    SketchBase* merged = asSketch(extension_hll_union_merge(extension_hll_empty(), asState(partial)));
+    CHECK(merged->lgK() == 16 && !merged->isReducedPrecision());
+    CHECK(merged->serialize() == expected);
+    merged = asSketch(extension_hll_union_merge(asState(merged), extension_hll_empty()));
+    CHECK(merged->lgK() == 16 && !merged->isReducedPrecision());
+
+    // A genuine fold to the smaller lgK is flagged.
+    SketchBase* small = sketchOf(12, 0, 10).release();
+    merged = asSketch(extension_hll_union_merge(asState(merged), asState(small)));
+    CHECK(merged->lgK() == 12 && merged->isReducedPrecision());
+    CHECK(registersOf(*merged) == registersOf(*sketchOf(12, 0, 20000)));
+    delete merged;
+}
+
+TEST_CASE(testScalarUnionMarksFold) {
+    Bytes wide = sketchOf(14, 0, 20000)->serialize();
+    Bytes narrow = sketchOf(12, 0, 10)->serialize();
+    extension_list_u8_t left = view(wide), right = view(narrow), ret{};
+    extension_hll_union(&left, &right, &ret);
+    std::unique_ptr<SketchBase> merged = hll::deserialize(ret.ptr, ret.len);
+    free(ret.ptr);
+    CHECK(merged->lgK() == 12 && merged->isReducedPrecision());
+    CHECK(registersOf(*merged) == registersOf(*sketchOf(12, 0, 20000)));
+
+    // Equal lgK, or an empty side, is not a fold.
+    Bytes same = sketchOf(14, 100, 200)->serialize();
+    Bytes empty = hll::makeSketch(12)->serialize();
+    for (const Bytes* other : {&same, &empty}) {
+        right = view(*other);
+        extension_hll_union(&left, &right, &ret);
+        merged = hll::deserialize(ret.ptr, ret.len);
+        free(ret.ptr);
+        CHECK(merged->lgK() == 14 && !merged->isReducedPrecision());
+    }
+}
+
+TEST_CASE(testBudget) {
+    uint64_t degraded = extension_hll_degraded_states();
+    // The first row sets the limit: room for about one and a half dense lgK 14 groups.
+    SketchBase* a = asSketch(addBudgeted(0, 0, 20000, 14, 30000));
+    CHECK(a->isDense() && a->lgK() == 14 && !a->isReducedPrecision());
+
+    // The second group turns dense without room for lgK 14 and folds once, to
+    // the largest lgK that fits: 13, not all the way down to 8.
+    SketchBase* b = asSketch(addBudgeted(0, 100000, 120000, 14, 30000));
+    CHECK(b->isDense() && b->lgK() == 13 && b->isReducedPrecision());
+    CHECK(extension_hll_degraded_states() == degraded + 1);
+    CHECK(registersOf(*b) == registersOf(*sketchOf(13, 100000, 120000)));
+
+    // Later rows neither change the limit nor fold groups that are dense already.
+    a = asSketch(addBudgeted(asState(a), 20000, 40000, 14, 1));
+    b = asSketch(addBudgeted(asState(b), 120000, 140000, 14, 1));
+    CHECK(a->lgK() == 14 && !a->isReducedPrecision());
+    CHECK(b->lgK() == 13);
+    SketchBase* c = asSketch(addBudgeted(0, 200000, 200100, 14, 1));
+    CHECK(c->isSparse() && c->lgK() == 14);
+    c = asSketch(addBudgeted(asState(c), 200100, 220000, 14, 1));
+    CHECK(c->isDense() && c->lgK() == 12 && c->isReducedPrecision());
+    CHECK(extension_hll_degraded_states() == degraded + 2);
+
+    delete a;
+    delete b;
+    delete c;
+}
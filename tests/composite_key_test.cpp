@@ -0,0 +1,106 @@
+// Composite keys: hll_add_agg_multi2/3 and their BIGINT variants hash each
+// field on its own and combine the field hashes.
+#include "test_util.h"
+
+#include <cmath>
+#include <set>
+#include <utility>
+
+using namespace hll_test;
+
+namespace {
+
+extension_list_u8_t field(std::string& value) {
+    return extension_list_u8_t{reinterpret_cast<uint8_t*>(value.data()), value.size()};
+}
+
+uint64_t textHash(const std::string& value) {
+    return hll::hash(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+}
+
+// Serialized sketch of a single tuple; sparse coupons keep 25 bits of the hash.
+Bytes tuple(std::string a, std::string b) {
+    extension_list_u8_t fa = field(a), fb = field(b);
+    SketchBase* sketch = asSketch(extension_hll_add_multi2(extension_hll_empty(), &fa, &fb));
+    Bytes blob = sketch->serialize();
+    delete sketch;
+    return blob;
+}
+
+Bytes tuple(std::string a, std::string b, std::string c) {
+    extension_list_u8_t fa = field(a), fb = field(b), fc = field(c);
+    SketchBase* sketch = asSketch(extension_hll_add_multi3(extension_hll_empty(), &fa, &fb, &fc));
+    Bytes blob = sketch->serialize();
+    delete sketch;
+    return blob;
+}
+
+Bytes tuple(int64_t a, int64_t b) {
+    SketchBase* sketch = asSketch(extension_hll_add_multi2_int(extension_hll_empty(), a, b));
+    Bytes blob = sketch->serialize();
+    delete sketch;
+    return blob;
+}
+
+Bytes sketchOfHash(uint64_t hash) {
+    std::unique_ptr<SketchBase> sketch = hll::makeSketch();
+    sketch->updateWithHash(hash);
+    return sketch->serialize();
+}
+
+} // namespace
+
+TEST_CASE(testCompositeKeysAreOrdered) {
+    CHECK(tuple("a", "b") != tuple("b", "a"));
+    CHECK(tuple(1, 2) != tuple(2, 1));
+    CHECK(tuple("ab", "c") != tuple("a", "bc"));
+    CHECK(tuple("", "abc") != tuple("abc", ""));
+    // The field count is part of the key.
+    CHECK(tuple("a", "b", "") != tuple("a", "b"));
+    CHECK(tuple("a", "b") == tuple("a", "b"));
+}
+
+TEST_CASE(testCompositeKeysHashFields) {
+    // hll_add_agg_multi2 over (a, b) is the same as adding the combined field
+    // hashes directly, row by row.
+    extension_state_t state = extension_hll_empty();
+    std::unique_ptr<SketchBase> direct = hll::makeSketch();
+    for (int i = 0; i < 5000; ++i) {
+        std::string a = key(i % 700), b = key(i % 13);
+        extension_list_u8_t fa = field(a), fb = field(b);
+        state = extension_hll_add_multi2(state, &fa, &fb);
+        direct->updateWithHash(hll::combineHashes({textHash(a), textHash(b)}));
+    }
+    CHECK(asSketch(state)->serialize() == direct->serialize());
+    delete asSketch(state);
+
+    std::string text = "device";
+    extension_list_u8_t blob = field(text);
+    state = extension_hll_add_multi_int_bytes(extension_hll_empty(), 42, &blob);
+    CHECK(asSketch(state)->serialize() ==
+          sketchOfHash(hll::combineHashes({hll::hashInt(42), textHash(text)})));
+    delete asSketch(state);
+    CHECK(tuple(-1, 7) == sketchOfHash(hll::combineHashes({hll::hashInt(uint64_t(-1)), hll::hashInt(7)})));
+}
+
+TEST_CASE(testCompositeKeyVariantsAgree) {
+    // The BIGINT variant hashes integers, the LONGBLOB variant their decimal
+    // text. The hashes differ, but both see the same distinct tuples.
+    extension_state_t ints = extension_hll_empty();
+    extension_state_t texts = extension_hll_empty();
+    extension_state_t mixed = extension_hll_empty();
+    std::set<std::pair<int64_t, int64_t>> distinct;
+    for (int64_t i = 0; i < 3000; ++i) {
+        int64_t a = (i * 7) % 40 - 20, b = i % 25;
+        distinct.insert({a, b});
+        std::string ta = std::to_string(a), tb = std::to_string(b);
+        extension_list_u8_t fa = field(ta), fb = field(tb);
+        ints = extension_hll_add_multi2_int(ints, a, b);
+        texts = extension_hll_add_multi2(texts, &fa, &fb);
+        mixed = extension_hll_add_multi_int_bytes(mixed, a, &fb);
+    }
+    for (extension_state_t state : {ints, texts, mixed}) {
+        CHECK(std::llround(asSketch(state)->estimate()) == static_cast<long long>(distinct.size()));
+        delete asSketch(state);
+    }
+}
@@ -0,0 +1,81 @@
+// hll_count, the terminator of hll_count_distinct and hll_union_count.
+#include "test_util.h"
+
+#include <cmath>
+
+using namespace hll_test;
+
+namespace {
+
+// What hll_cardinality(hll_serialize(state)) returns, rounded.
+long long roundedCardinality(extension_state_t state) {
+    extension_list_u8_t ret{};
+    extension_hll_serialize(state, &ret);
+    Bytes blob = take(ret);
+    extension_list_u8_t data = view(blob);
+    return std::llround(extension_hll_cardinality(&data));
+}
+
+// Ships a partial aggregate state between nodes, as SERIALIZE/DESERIALIZE do.
+extension_state_t transport(extension_state_t state) {
+    extension_list_u8_t ret{};
+    extension_hll_serialize_state(state, &ret);
+    Bytes blob = take(ret);
+    delete asSketch(state);
+    extension_list_u8_t data = view(blob);
+    return extension_hll_deserialize_state(&data);
+}
+
+} // namespace
+
+TEST_CASE(testCountMatchesCardinality) {
+    CHECK(extension_hll_count(0) == 0);
+
+    std::vector<extension_state_t> states = {
+        extension_hll_empty(),
+        addKeys(extension_hll_empty(), 0, 100),
+        addKeys(extension_hll_empty(), 0, 30000),
+        asState(sketchOf(16, 0, 500).release()),
+        // Folded from lgK 14 to 12 by the merge, so flagged as reduced precision.
+        extension_hll_union_merge(asState(sketchOf(14, 0, 20000).release()),
+                                  asState(sketchOf(12, 10000, 12000).release())),
+    };
+    CHECK(asSketch(states.back())->isReducedPrecision());
+    for (extension_state_t state : states) {
+        CHECK(extension_hll_count(state) == roundedCardinality(state));
+        delete asSketch(state);
+    }
+    extension_state_t empty = extension_hll_empty();
+    CHECK(extension_hll_count(empty) == 0);
+    delete asSketch(empty);
+}
+
+TEST_CASE(testCountAggregates) {
+    // hll_count_distinct: hll_add per row on two nodes, the states shipped and
+    // merged, then hll_count.
+    extension_state_t left = transport(addKeys(extension_hll_empty(), 0, 15000));
+    extension_state_t right = transport(addKeys(extension_hll_empty(), 10000, 40000));
+    extension_state_t merged = extension_hll_union_merge(left, right);
+    CHECK(extension_hll_count(merged) == std::llround(sketchOf(12, 0, 40000)->estimate()));
+    CHECK(extension_hll_count(merged) == roundedCardinality(merged));
+    delete asSketch(merged);
+
+    // hll_union_count: hll_union_agg over serialized sketches, including one
+    // at another lgK, then hll_count.
+    Bytes blobs[] = {sketchOf(12, 0, 5000)->serialize(), sketchOf(12, 3000, 9000)->serialize_compact(),
+                     sketchOf(14, 8000, 20000)->serialize()};
+    extension_state_t first = extension_hll_empty(), second = extension_hll_empty();
+    for (int i = 0; i < 3; ++i) {
+        extension_list_u8_t input = view(blobs[i]);
+        if (i < 2) {
+            first = extension_hll_union_agg(first, &input);
+        } else {
+            second = extension_hll_union_agg(second, &input);
+        }
+    }
+    merged = extension_hll_union_merge(transport(first), transport(second));
+    CHECK(asSketch(merged)->lgK() == 12);
+    CHECK(registersOf(*asSketch(merged)) == registersOf(*sketchOf(12, 0, 20000)));
+    CHECK(extension_hll_count(merged) == roundedCardinality(merged));
+    delete asSketch(merged);
+}
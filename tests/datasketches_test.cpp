@@ -0,0 +1,167 @@
+// Apache DataSketches HLL import, export and union (hll_from_datasketches,
+// hll_to_datasketches, hll_union_agg) against the fixtures in
+// tests/fixtures/datasketches.
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include "test_util.h"
+
+using namespace hll_test;
+
+namespace {
+
+Bytes fromDataSketches(const Bytes& image) {
+    extension_list_u8_t in = view(image), ret;
+    extension_hll_from_datasketches(&in, &ret);
+    return take(ret);
+}
+
+Bytes toDataSketches(const Bytes& blob, const char* type) {
+    extension_list_u8_t in = view(blob), ret;
+    extension_string_t name{const_cast<char*>(type), std::strlen(type)};
+    extension_hll_to_datasketches(&in, &name, &ret);
+    return take(ret);
+}
+
+double readDouble(const Bytes& bytes, size_t offset) {
+    double value;
+    std::memcpy(&value, &bytes[offset], sizeof(double));
+    return value;
+}
+
+} // namespace
+
+TEST_CASE(testDataSketchesImport) {
+    const char* fixtures[] = {"list_lgk12_hll4", "set_lgk12_hll8", "hll4_lgk14",
+                              "hll4_lgk6_curmin", "hll6_lgk14", "hll8_lgk14"};
+    for (const char* name : fixtures) {
+        std::string base = std::string("datasketches/") + name;
+        int lgK;
+        Registers expected = readExpected(base + ".txt", lgK);
+        Bytes blob = fromDataSketches(readFile(base + ".sk"));
+        std::unique_ptr<SketchBase> sketch = hll::deserialize(blob.data(), blob.size());
+        CHECK(sketch != nullptr);
+        if (!sketch) continue;
+        CHECK(sketch->lgK() == lgK);
+        CHECK(registersOf(*sketch) == expected);
+    }
+}
+
+// hll_union_agg starts from hll_empty (lgK 12) and must take the lgK of the
+// DataSketches input instead of cutting it down to 12.
+TEST_CASE(testDataSketchesUnion) {
+    int lgK;
+    Registers expected = readExpected("datasketches/hll8_lgk14.txt", lgK);
+    Bytes image = readFile("datasketches/hll8_lgk14.sk");
+    extension_list_u8_t in = view(image);
+    SketchBase* state = asSketch(extension_hll_union_agg(extension_hll_empty(), &in));
+    CHECK(state->lgK() == 14 && !state->isReducedPrecision());
+    CHECK(registersOf(*state) == expected);
+
+    // A smaller DataSketches input folds the state down to its lgK.
+    Bytes small = readFile("datasketches/hll4_lgk6_curmin.sk");
+    in = view(small);
+    state = asSketch(extension_hll_union_agg(asState(state), &in));
+    CHECK(state->lgK() == 6 && state->isReducedPrecision());
+    delete state;
+}
+
+TEST_CASE(testDataSketchesExport) {
+    struct Case { const char* name; const char* type; };
+    const Case cases[] = {{"hll4_lgk14", "HLL_4"}, {"hll4_lgk6_curmin", "HLL_4"},
+                          {"hll6_lgk14", "HLL_6"}, {"hll8_lgk14", "HLL_8"}};
+    for (const Case& c : cases) {
+        std::string base = std::string("datasketches/") + c.name;
+        Bytes image = readFile(base + ".sk");
+        Bytes exported = toDataSketches(fromDataSketches(image), c.type);
+        CHECK(exported.size() == image.size());
+        if (exported.size() != image.size()) continue;
+
+        // Same mode, target type, curMin, numAtCurMin and aux count; the
+        // export has no HIP history, so it is flagged out of order instead.
+        for (size_t i : {0, 1, 2, 3, 6, 7, 32, 33, 34, 35, 36, 37, 38, 39}) {
+            CHECK(exported[i] == image[i]);
+        }
+        CHECK((exported[5] & hll::DS_OUT_OF_ORDER_FLAG_MASK) != 0);
+        CHECK(std::abs(readDouble(exported, 16) - readDouble(image, 16)) < 1e-9);
+        CHECK(std::abs(readDouble(exported, 24) - readDouble(image, 24)) < 1e-9);
+
+        size_t auxStart = hll::DS_HLL_BYTE_ARR_START + hll::dsHllArrayBytes(
+            (image[7] >> 2) & 3, image[3]);
+        CHECK(std::equal(image.begin() + hll::DS_HLL_BYTE_ARR_START, image.begin() + auxStart,
+                         exported.begin() + hll::DS_HLL_BYTE_ARR_START));
+        // Aux pairs are written in hash-table order by DataSketches, slot order here.
+        std::set<uint32_t> imageAux, exportedAux;
+        for (size_t i = auxStart; i + 4 <= image.size(); i += 4) {
+            imageAux.insert(hll::readLE32(&image[i]));
+            exportedAux.insert(hll::readLE32(&exported[i]));
+        }
+        CHECK(imageAux == exportedAux);
+
+        Bytes reimported = fromDataSketches(exported);
+        std::unique_ptr<SketchBase> back = hll::deserialize(reimported.data(), reimported.size());
+        int lgK;
+        CHECK(back && registersOf(*back) == readExpected(base + ".txt", lgK));
+    }
+}
+
+TEST_CASE(testDataSketchesRejectsOversizeTables) {
+    // Updatable images size their coupon and aux tables by lgArr; a corrupt
+    // lgArr must be rejected before it is used as a shift, in either layout.
+    for (const char* name : {"list_lgk12_hll4", "set_lgk12_hll8", "hll4_lgk14"}) {
+        Bytes image = readFile(std::string("datasketches/") + name + ".sk");
+        CHECK(!fromDataSketches(image).empty());
+        for (int compact = 0; compact < 2; ++compact) {
+            Bytes corrupt = image;
+            if (!compact) corrupt[5] &= ~hll::COMPACT_FLAG_MASK;
+            for (uint8_t lgArr : {16, 31, 136, 239}) {
+                corrupt[4] = lgArr;
+                CHECK(fromDataSketches(corrupt).empty());
+                extension_list_u8_t in = view(corrupt);
+                SketchBase* state = asSketch(extension_hll_union_agg(extension_hll_empty(), &in));
+                CHECK(state->isEmpty());
+                delete state;
+            }
+        }
+    }
+}
+
+// The exported/ images are what reference.py hands to the DataSketches library
+// to check that it reads our exports; they must stay what the exporter writes.
+TEST_CASE(testDataSketchesExportFixtures) {
+    std::unique_ptr<SketchBase> sketch = sketchOf(14, 0, 20000);
+    const char* files[] = {"hll4_lgk14.sk", "hll6_lgk14.sk", "hll8_lgk14.sk"};
+    for (int tgtHllType = 0; tgtHllType < 3; ++tgtHllType) {
+        CHECK(sketch->serialize_datasketches(tgtHllType) ==
+              readFile(std::string("datasketches/exported/") + files[tgtHllType]));
+    }
+    Bytes estimate = readFile("datasketches/exported/estimate");
+    double expected = std::strtod(std::string(estimate.begin(), estimate.end()).c_str(), nullptr);
+    CHECK(std::abs(sketch->estimate() - expected) < 1e-6);
+}
+
+// Images written by the DataSketches library itself (reference.py write),
+// listed in reference/MANIFEST: our estimate must agree with the library's.
+TEST_CASE(testDataSketchesLibraryReference) {
+    Bytes manifest = readFile("datasketches/reference/MANIFEST");
+    std::istringstream names(std::string(manifest.begin(), manifest.end()));
+    std::string name;
+    int checked = 0;
+    while (std::getline(names, name)) {
+        if (name.empty() || name[0] == '#') continue;
+        std::string base = "datasketches/reference/" + name;
+        Bytes image = readFile(base + ".sk");
+        Bytes estimate = readFile(base + ".estimate");
+        double theirs = std::strtod(std::string(estimate.begin(), estimate.end()).c_str(), nullptr);
+        Bytes blob = fromDataSketches(image);
+        std::unique_ptr<SketchBase> sketch = hll::deserialize(blob.data(), blob.size());
+        CHECK(sketch != nullptr);
+        if (!sketch) continue;
+        double tolerance = 3 * 1.04 / std::sqrt(double(1 << sketch->lgK()));
+        CHECK(std::abs(sketch->estimate() - theirs) <= tolerance * theirs);
+        checked++;
+    }
+    if (checked == 0) {
+        std::fprintf(stderr, "note: no DataSketches library images in reference/MANIFEST\n");
+    }
+}
@@ -0,0 +1,15 @@
+// Hot-path debug counters (HLL_DEBUG_COUNTERS, hll_debug_counters).
+#include "test_util.h"
+
+using namespace hll_test;
+
+TEST_CASE(testDataSketchesCounters) {
+    // Every successful DataSketches merge counts, whatever the mode of the image.
+    for (const char* name : {"list_lgk12_hll4", "set_lgk12_hll8", "hll8_lgk14"}) {
+        Bytes image = readFile(std::string("datasketches/") + name + ".sk");
+        uint64_t before = hll::debugCounters.mergesDataSketches.load();
+        std::unique_ptr<SketchBase> sketch = hll::makeSketch(image[3]);
+        CHECK(sketch->mergeDataSketches(image.data(), image.size()));
+        CHECK(hll::debugCounters.mergesDataSketches.load() == before + 1);
+    }
+}
@@ -0,0 +1,47 @@
+// Delta snapshots (hll_delta, hll_apply_delta and deltas in hll_union_agg).
+#include "test_util.h"
+
+using namespace hll_test;
+
+TEST_CASE(testDeltaRoundTrip) {
+    for (int lgK : {12, 14}) {
+        for (int compact = 0; compact < 2; ++compact) {
+            std::unique_ptr<SketchBase> base = sketchOf(lgK, 0, 500);
+            std::unique_ptr<SketchBase> newer = sketchOf(lgK, 0, 800);
+            std::unique_ptr<SketchBase> newest = sketchOf(lgK, 0, 30000);
+            auto blob = [&](const SketchBase& s) { return compact ? s.serialize_compact() : s.serialize(); };
+            Bytes baseBlob = blob(*base);
+            Bytes newerBlob = blob(*newer);
+            Bytes newestBlob = blob(*newest);
+
+            extension_list_u8_t a = view(baseBlob), b = view(newerBlob), c = view(newestBlob), ret;
+            extension_hll_delta(&a, &b, &ret);
+            Bytes delta1 = take(ret);
+            extension_hll_delta(&b, &c, &ret);
+            Bytes delta2 = take(ret);
+            CHECK(hll::isDeltaBlob(delta1.data(), delta1.size()));
+            CHECK(hll::isDeltaBlob(delta2.data(), delta2.size()));
+
+            extension_list_u8_t d1 = view(delta1), d2 = view(delta2);
+            extension_hll_apply_delta(&a, &d1, &ret);
+            CHECK(take(ret) == newerBlob);
+            extension_hll_apply_delta(&b, &d2, &ret);
+            CHECK(take(ret) == newestBlob);
+
+            // hll_union_agg over the base and its deltas, in either order,
+            // rebuilds the newest snapshot at the sketches' own lgK.
+            SketchBase* state = asSketch(extension_hll_union_agg(extension_hll_empty(), &a));
+            state = asSketch(extension_hll_union_agg(asState(state), &d1));
+            state = asSketch(extension_hll_union_agg(asState(state), &d2));
+            CHECK(state->lgK() == lgK && !state->isReducedPrecision());
+            CHECK(state->serialize() == newest->serialize());
+            delete state;
+            state = asSketch(extension_hll_union_agg(extension_hll_empty(), &d2));
+            state = asSketch(extension_hll_union_agg(asState(state), &d1));
+            state = asSketch(extension_hll_union_agg(asState(state), &a));
+            CHECK(state->lgK() == lgK && !state->isReducedPrecision());
+            CHECK(registersOf(*state) == registersOf(*newest));
+            delete state;
+        }
+    }
+}
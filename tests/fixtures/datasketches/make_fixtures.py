@@ -0,0 +1,408 @@
+#!/usr/bin/env python3
+"""Writes the Apache DataSketches HLL fixtures used by tests/hll_test.cpp.
+
+Each fixture is the compact image that the DataSketches HllSketch produces for
+update(long) over a fixed list of keys, next to a .txt file with the register
+values it represents. The update path is modelled on datasketches-java
+(HllSketch, CouponList, CouponHashSet, Hll4Array/Hll6Array/Hll8Array,
+AuxHashMap and ToByteArrayImpl):
+
+* keys are hashed with MurmurHash3_x64_128 over the 8 little-endian bytes of
+  the long, seed 9001, into a 26-bit address and a leading-zero value;
+* LIST mode holds 8 coupons, then turns into a SET (lgK >= 8) or straight into
+  an HLL array; the SET grows at 3/4 load and turns into an HLL array when it
+  would grow past lgK - 3;
+* HLL_4 keeps register values relative to curMin, with values 15 and more
+  above curMin in the aux hash map, and shifts curMin when no register is left
+  at it;
+* compact serialization writes only the valid coupons or aux pairs, in
+  table order.
+
+The one field not reproduced is the HIP accumulator of HLL images:
+DataSketches seeds it on promotion from its coupon-count interpolation tables,
+while this model keeps the incremental HIP sum. The extension never reads it.
+
+Run from this directory: python3 make_fixtures.py
+"""
+
+import struct
+
+MASK64 = (1 << 64) - 1
+SEED = 9001
+KEY_BITS_26 = 26
+KEY_MASK_26 = (1 << KEY_BITS_26) - 1
+AUX_TOKEN = 15
+LG_AUX_ARR_INTS = [0, 2, 2, 2, 2, 2, 2, 3, 3, 3, 4, 4, 5, 5, 6, 7, 8, 9, 10, 11, 12, 13]
+HLL_4, HLL_6, HLL_8 = 0, 1, 2
+LIST, SET, HLL = 0, 1, 2
+COMPACT_FLAG = 8
+
+
+def rotl64(x, r):
+    return ((x << r) | (x >> (64 - r))) & MASK64
+
+
+def fmix64(k):
+    k ^= k >> 33
+    k = (k * 0xff51afd7ed558ccd) & MASK64
+    k ^= k >> 33
+    k = (k * 0xc4ceb9fe1a85ec53) & MASK64
+    k ^= k >> 33
+    return k
+
+
+def murmur3_x64_128(data, seed):
+    c1, c2 = 0x87c37b91114253d5, 0x4cf5ad432745937f
+    h1 = h2 = seed
+    blocks = len(data) // 16
+    for i in range(blocks):
+        k1 = int.from_bytes(data[16 * i:16 * i + 8], "little")
+        k2 = int.from_bytes(data[16 * i + 8:16 * i + 16], "little")
+        k1 = rotl64((k1 * c1) & MASK64, 31) * c2 & MASK64
+        h1 = (rotl64(h1 ^ k1, 27) + h2) & MASK64
+        h1 = (h1 * 5 + 0x52dce729) & MASK64
+        k2 = rotl64((k2 * c2) & MASK64, 33) * c1 & MASK64
+        h2 = (rotl64(h2 ^ k2, 31) + h1) & MASK64
+        h2 = (h2 * 5 + 0x38495ab5) & MASK64
+    tail = data[16 * blocks:]
+    if len(tail) > 8:
+        k2 = int.from_bytes(tail[8:], "little")
+        h2 ^= rotl64((k2 * c2) & MASK64, 33) * c1 & MASK64
+    if len(tail) > 0:
+        k1 = int.from_bytes(tail[:8], "little")
+        h1 ^= rotl64((k1 * c1) & MASK64, 31) * c2 & MASK64
+    h1 ^= len(data)
+    h2 ^= len(data)
+    h1 = (h1 + h2) & MASK64
+    h2 = (h2 + h1) & MASK64
+    h1 = fmix64(h1)
+    h2 = fmix64(h2)
+    h1 = (h1 + h2) & MASK64
+    h2 = (h2 + h1) & MASK64
+    return h1, h2
+
+
+def coupon_of(key):
+    h0, h1 = murmur3_x64_128(struct.pack("<q", key), SEED)
+    lz = 64 - h1.bit_length()
+    return ((min(lz, 62) + 1) << KEY_BITS_26) | (h0 & KEY_MASK_26)
+
+
+def set_find(arr, lg_arr, coupon):
+    mask = (1 << lg_arr) - 1
+    probe = coupon & mask
+    start = probe
+    while True:
+        if arr[probe] == 0:
+            return ~probe
+        if arr[probe] == coupon:
+            return probe
+        stride = ((coupon & KEY_MASK_26) >> lg_arr) | 1
+        probe = (probe + stride) & mask
+        if probe == start:
+            raise RuntimeError("coupon set full")
+
+
+class AuxMap:
+    def __init__(self, lg_aux, lg_k):
+        self.lg = lg_aux
+        self.lg_k = lg_k
+        self.arr = [0] * (1 << lg_aux)
+        self.count = 0
+
+    def find(self, slot):
+        mask = (1 << self.lg) - 1
+        kmask = (1 << self.lg_k) - 1
+        probe = slot & mask
+        start = probe
+        while True:
+            if self.arr[probe] == 0:
+                return ~probe
+            if (self.arr[probe] & kmask) == slot:
+                return probe
+            probe = (probe + ((slot >> self.lg) | 1)) & mask
+            if probe == start:
+                raise RuntimeError("aux map full")
+
+    def must_add(self, slot, value):
+        index = self.find(slot)
+        assert index < 0
+        self.arr[~index] = (value << KEY_BITS_26) | slot
+        self.count += 1
+        if 4 * self.count > 3 * len(self.arr):
+            old = self.arr
+            self.lg += 1
+            self.arr = [0] * (1 << self.lg)
+            for pair in old:
+                if pair != 0:
+                    self.arr[~self.find(pair & ((1 << self.lg_k) - 1))] = pair
+
+    def must_replace(self, slot, value):
+        index = self.find(slot)
+        assert index >= 0
+        self.arr[index] = (value << KEY_BITS_26) | slot
+
+    def value_of(self, slot):
+        index = self.find(slot)
+        assert index >= 0
+        return self.arr[index] >> KEY_BITS_26
+
+    def pairs(self):
+        return [pair for pair in self.arr if pair != 0]
+
+
+class HllArray:
+    def __init__(self, lg_k, tgt):
+        self.lg_k = lg_k
+        self.k = 1 << lg_k
+        self.tgt = tgt
+        self.values = [0] * self.k  # HLL_6/HLL_8 values, HLL_4 nibbles
+        self.aux = None
+        self.cur_min = 0
+        self.num_at_cur_min = self.k
+        self.hip = 0.0
+        self.kxq0 = float(self.k)
+        self.kxq1 = 0.0
+
+    def hip_kxq_update(self, old, new):
+        self.hip += self.k / (self.kxq0 + self.kxq1)
+        if old < 32:
+            self.kxq0 -= 1.0 / (1 << old)
+        else:
+            self.kxq1 -= 1.0 / (1 << old)
+        if new < 32:
+            self.kxq0 += 1.0 / (1 << new)
+        else:
+            self.kxq1 += 1.0 / (1 << new)
+
+    def coupon_update(self, coupon):
+        slot = coupon & (self.k - 1)
+        new = coupon >> KEY_BITS_26
+        if self.tgt != HLL_4:
+            old = self.values[slot]
+            if new > old:
+                self.values[slot] = new
+                self.hip_kxq_update(old, new)
+                if old == 0:
+                    self.num_at_cur_min -= 1
+            return
+        raw = self.values[slot]
+        lower_bound = raw + self.cur_min
+        if new <= lower_bound:
+            return
+        old = lower_bound if raw < AUX_TOKEN else self.aux.value_of(slot)
+        if new <= old:
+            return
+        self.hip_kxq_update(old, new)
+        shifted = new - self.cur_min
+        if raw == AUX_TOKEN:
+            assert shifted >= AUX_TOKEN
+            self.aux.must_replace(slot, new)
+        elif shifted >= AUX_TOKEN:
+            self.values[slot] = AUX_TOKEN
+            if self.aux is None:
+                self.aux = AuxMap(LG_AUX_ARR_INTS[self.lg_k], self.lg_k)
+            self.aux.must_add(slot, new)
+        else:
+            self.values[slot] = shifted
+        if old == self.cur_min:
+            self.num_at_cur_min -= 1
+            while self.num_at_cur_min == 0:
+                self.shift_to_bigger_cur_min()
+
+    def shift_to_bigger_cur_min(self):
+        new_cur_min = self.cur_min + 1
+        num_at_new = 0
+        for i in range(self.k):
+            nibble = self.values[i]
+            assert nibble != 0
+            if nibble < AUX_TOKEN:
+                self.values[i] = nibble - 1
+                if nibble - 1 == 0:
+                    num_at_new += 1
+        new_aux = None
+        if self.aux is not None:
+            for pair in self.aux.pairs():
+                slot = pair & (self.k - 1)
+                value = pair >> KEY_BITS_26
+                if value - new_cur_min < AUX_TOKEN:
+                    self.values[slot] = value - new_cur_min
+                else:
+                    if new_aux is None:
+                        new_aux = AuxMap(LG_AUX_ARR_INTS[self.lg_k], self.lg_k)
+                    new_aux.must_add(slot, value)
+        self.aux = new_aux
+        self.cur_min = new_cur_min
+        self.num_at_cur_min = num_at_new
+
+    def register(self, slot):
+        if self.tgt != HLL_4:
+            return self.values[slot]
+        if self.values[slot] == AUX_TOKEN:
+            return self.aux.value_of(slot)
+        return self.values[slot] + self.cur_min
+
+    def array_bytes(self):
+        if self.tgt == HLL_8:
+            return bytes(self.values)
+        if self.tgt == HLL_6:
+            out = bytearray(((self.k * 3) >> 2) + 1)
+            for i, value in enumerate(self.values):
+                start = i * 6
+                bits = value << (start & 7)
+                out[start >> 3] |= bits & 0xFF
+                out[(start >> 3) + 1] |= bits >> 8
+            return bytes(out)
+        out = bytearray(self.k // 2)
+        for i, nibble in enumerate(self.values):
+            out[i >> 1] |= (nibble << 4) if i & 1 else nibble
+        return bytes(out)
+
+    def serialize(self):
+        aux_pairs = self.aux.pairs() if self.aux is not None else []
+        header = bytearray(40)
+        header[0] = 10
+        header[1] = 1
+        header[2] = 7
+        header[3] = self.lg_k
+        header[4] = self.aux.lg if self.aux is not None else 0
+        header[5] = COMPACT_FLAG
+        header[6] = self.cur_min
+        header[7] = HLL | (self.tgt << 2)
+        struct.pack_into("<dddii", header, 8, self.hip, self.kxq0, self.kxq1,
+                         self.num_at_cur_min, len(aux_pairs))
+        return bytes(header) + self.array_bytes() + b"".join(struct.pack("<I", p) for p in aux_pairs)
+
+
+class DsSketch:
+    def __init__(self, lg_k, tgt):
+        self.lg_k = lg_k
+        self.tgt = tgt
+        self.mode = LIST
+        self.lg_arr = 3
+        self.coupons = [0] * 8
+        self.count = 0
+        self.hll = None
+
+    def update(self, key):
+        coupon = coupon_of(key)
+        if self.mode == HLL:
+            self.hll.coupon_update(coupon)
+        elif self.mode == LIST:
+            for i, existing in enumerate(self.coupons):
+                if existing == 0:
+                    self.coupons[i] = coupon
+                    self.count += 1
+                    if self.count >= len(self.coupons):
+                        if self.lg_k < 8:
+                            self.promote_to_hll()
+                        else:
+                            self.promote_to_set()
+                    return
+                if existing == coupon:
+                    return
+        else:
+            index = set_find(self.coupons, self.lg_arr, coupon)
+            if index >= 0:
+                return
+            self.coupons[~index] = coupon
+            self.count += 1
+            if 4 * self.count > 3 * (1 << self.lg_arr):
+                if self.lg_arr == self.lg_k - 3:
+                    self.promote_to_hll()
+                else:
+                    self.grow_set(self.lg_arr + 1)
+
+    def grow_set(self, lg_arr):
+        old = self.coupons
+        self.lg_arr = lg_arr
+        self.coupons = [0] * (1 << lg_arr)
+        for coupon in old:
+            if coupon != 0:
+                self.coupons[~set_find(self.coupons, lg_arr, coupon)] = coupon
+
+    def promote_to_set(self):
+        old = self.coupons
+        self.mode = SET
+        self.lg_arr = 5
+        self.coupons = [0] * 32
+        self.count = 0
+        for coupon in old:
+            if coupon != 0:
+                self.coupons[~set_find(self.coupons, self.lg_arr, coupon)] = coupon
+                self.count += 1
+
+    def promote_to_hll(self):
+        self.hll = HllArray(self.lg_k, self.tgt)
+        for coupon in self.coupons:
+            if coupon != 0:
+                self.hll.coupon_update(coupon)
+        self.mode = HLL
+        self.coupons = None
+
+    def registers(self):
+        k = 1 << self.lg_k
+        if self.mode == HLL:
+            return [self.hll.register(i) for i in range(k)]
+        regs = [0] * k
+        for coupon in self.coupons:
+            if coupon != 0:
+                slot = coupon & (k - 1)
+                regs[slot] = max(regs[slot], coupon >> KEY_BITS_26)
+        return regs
+
+    def serialize(self):
+        if self.mode == HLL:
+            return self.hll.serialize()
+        valid = [c for c in self.coupons if c != 0]
+        if self.mode == LIST:
+            header = bytes([2, 1, 7, self.lg_k, self.lg_arr, COMPACT_FLAG, len(valid),
+                            LIST | (self.tgt << 2)])
+        else:
+            header = bytes([3, 1, 7, self.lg_k, self.lg_arr, COMPACT_FLAG, 0,
+                            SET | (self.tgt << 2)]) + struct.pack("<i", len(valid))
+        return header + b"".join(struct.pack("<I", c) for c in valid)
+
+
+def write_fixture(name, lg_k, tgt, keys, expected_mode):
+    sketch = DsSketch(lg_k, tgt)
+    for key in keys:
+        sketch.update(key)
+    assert sketch.mode == expected_mode, (name, sketch.mode)
+    with open(name + ".sk", "wb") as f:
+        f.write(sketch.serialize())
+    with open(name + ".txt", "w") as f:
+        f.write("# lgK, then slot and value of every non-zero register\n")
+        f.write("%d\n" % lg_k)
+        for slot, value in enumerate(sketch.registers()):
+            if value != 0:
+                f.write("%d %d\n" % (slot, value))
+    return sketch
+
+
+def keys_with_aux(count, lg_k, min_aux):
+    """The first count keys, extended until min_aux of them go to the aux map."""
+    keys = []
+    high = 0
+    key = 0
+    while len(keys) < count or high < min_aux:
+        keys.append(key)
+        if (coupon_of(key) >> KEY_BITS_26) >= AUX_TOKEN:
+            high += 1
+        key += 1
+    return keys
+
+
+def main():
+    write_fixture("list_lgk12_hll4", 12, HLL_4, range(5), LIST)
+    write_fixture("set_lgk12_hll8", 12, HLL_8, range(200), SET)
+    sketch = write_fixture("hll4_lgk14", 14, HLL_4, keys_with_aux(20000, 14, 3), HLL)
+    assert sketch.hll.cur_min == 0 and sketch.hll.aux is not None
+    sketch = write_fixture("hll4_lgk6_curmin", 6, HLL_4, range(3000), HLL)
+    assert sketch.hll.cur_min > 0
+    write_fixture("hll6_lgk14", 14, HLL_6, range(20000), HLL)
+    write_fixture("hll8_lgk14", 14, HLL_8, range(20000), HLL)
+
+
+if __name__ == "__main__":
+    main()
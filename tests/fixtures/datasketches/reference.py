@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Cross-checks the DataSketches fixtures against the DataSketches library.
+
+Needs the `datasketches` Python package (pip install datasketches), which
+wraps the DataSketches C++ library. Run from this directory:
+
+  python3 reference.py write   Writes reference/<name>.sk images produced by the
+                               library itself, plus reference/<name>.estimate
+                               with the library's estimate, and lists them in
+                               reference/MANIFEST. tests/datasketches_test.cpp
+                               imports every listed image and checks our
+                               estimate against the library's.
+
+  python3 reference.py check   Deserializes the images our exporter writes for
+                               key0..key19999 at lgK 14 (exported/*.sk; the
+                               test checks they match the current exporter
+                               byte for byte) with the library and compares
+                               its estimate with ours (exported/estimate). It
+                               also checks that make_fixtures.py yields the
+                               same registers as the library for the same keys.
+"""
+
+import glob
+import os
+import struct
+import sys
+
+import make_fixtures as model
+
+REFERENCE_DIR = "reference"
+EXPORTED_DIR = "exported"
+
+# name, lgK, target type, number of keys (0..n-1), expected mode
+REFERENCE_SKETCHES = [
+    ("list_lgk12", 12, "HLL_4", 5, model.LIST),
+    ("set_lgk12", 12, "HLL_8", 200, model.SET),
+    ("hll4_lgk14_aux", 14, "HLL_4", None, model.HLL),
+]
+
+
+def library():
+    try:
+        import datasketches
+    except ImportError:
+        sys.exit("the datasketches package is not installed (pip install datasketches)")
+    return datasketches
+
+
+def keys_for(name, lg_k, count):
+    if count is not None:
+        return list(range(count))
+    return model.keys_with_aux(20000, lg_k, 3)
+
+
+def library_registers(image):
+    """Registers of a library image, read with the layout make_fixtures.py models."""
+    lg_k = image[3]
+    k = 1 << lg_k
+    mode = image[7] & 3
+    tgt = (image[7] >> 2) & 3
+    regs = [0] * k
+    if mode != model.HLL:
+        start = 8 if mode == model.LIST else 12
+        count = image[6] if mode == model.LIST else struct.unpack_from("<i", image, 8)[0]
+        for (coupon,) in struct.iter_unpack("<I", image[start:start + 4 * count]):
+            slot = coupon & (k - 1)
+            regs[slot] = max(regs[slot], coupon >> model.KEY_BITS_26)
+        return regs
+    arr = image[40:]
+    if tgt == model.HLL_8:
+        return list(arr[:k])
+    if tgt == model.HLL_6:
+        for i in range(k):
+            start = i * 6
+            two = arr[start >> 3] | (arr[(start >> 3) + 1] << 8)
+            regs[i] = (two >> (start & 7)) & 0x3F
+        return regs
+    cur_min = image[6]
+    aux_count = struct.unpack_from("<i", image, 36)[0]
+    for i in range(k):
+        nibble = (arr[i >> 1] >> 4) if i & 1 else (arr[i >> 1] & 0x0F)
+        regs[i] = nibble + cur_min
+    aux = image[40 + k // 2:40 + k // 2 + 4 * aux_count]
+    for (pair,) in struct.iter_unpack("<I", aux):
+        regs[pair & (k - 1)] = pair >> model.KEY_BITS_26
+    return regs
+
+
+def write():
+    ds = library()
+    os.makedirs(REFERENCE_DIR, exist_ok=True)
+    names = []
+    for name, lg_k, tgt, count, mode in REFERENCE_SKETCHES:
+        sketch = ds.hll_sketch(lg_k, getattr(ds.tgt_hll_type, tgt))
+        for key in keys_for(name, lg_k, count):
+            sketch.update(key)
+        image = bytes(sketch.serialize_compact())
+        assert image[7] & 3 == mode, (name, image[7] & 3)
+        with open(os.path.join(REFERENCE_DIR, name + ".sk"), "wb") as f:
+            f.write(image)
+        with open(os.path.join(REFERENCE_DIR, name + ".estimate"), "w") as f:
+            f.write("%.17g\n" % sketch.get_estimate())
+        names.append(name)
+    with open(os.path.join(REFERENCE_DIR, "MANIFEST"), "w") as f:
+        f.write("# Images written by the DataSketches library (reference.py write)\n")
+        for name in names:
+            f.write(name + "\n")
+
+
+def check():
+    ds = library()
+    failures = 0
+    for path in sorted(glob.glob(os.path.join(EXPORTED_DIR, "*.sk"))):
+        with open(path, "rb") as f:
+            image = f.read()
+        with open(os.path.join(EXPORTED_DIR, "estimate")) as f:
+            ours = float(f.read())
+        sketch = ds.hll_sketch.deserialize(image)
+        theirs = sketch.get_estimate()
+        # Out-of-order images use the composite estimator; allow 2% on 20000 keys.
+        ok = abs(theirs - ours) <= 0.02 * ours
+        failures += not ok
+        print("%s: library %.1f, ours %.1f %s" % (path, theirs, ours, "ok" if ok else "MISMATCH"))
+
+    for name, lg_k, tgt, count, _ in REFERENCE_SKETCHES:
+        sketch = ds.hll_sketch(lg_k, getattr(ds.tgt_hll_type, tgt))
+        mirror = model.DsSketch(lg_k, getattr(model, tgt))
+        for key in keys_for(name, lg_k, count):
+            sketch.update(key)
+            mirror.update(key)
+        ok = library_registers(bytes(sketch.serialize_compact())) == mirror.registers()
+        failures += not ok
+        print("make_fixtures model vs library, %s: %s" % (name, "ok" if ok else "MISMATCH"))
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2 or sys.argv[1] not in ("write", "check"):
+        sys.exit("usage: reference.py write|check")
+    write() if sys.argv[1] == "write" else check()
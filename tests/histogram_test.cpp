@@ -0,0 +1,75 @@
+// The register histogram dense sketches keep up to date incrementally, which
+// estimate() and isEmpty() read instead of rescanning the registers.
+#include "test_util.h"
+
+#include <algorithm>
+
+using namespace hll_test;
+
+namespace {
+
+// Compares the incremental histogram with a recount over the registers.
+void checkHistogram(const SketchBase& sketch) {
+    CHECK(sketch.isDense());
+    uint32_t recount[hll::HISTOGRAM_SIZE] = {};
+    recount[0] = 1u << sketch.lgK();
+    sketch.forEachRegister([&](uint32_t, uint8_t value) {
+        recount[0]--;
+        recount[value & (hll::HISTOGRAM_SIZE - 1)]++;
+    });
+    uint32_t histogram[hll::HISTOGRAM_SIZE];
+    sketch.computeHistogram(histogram);
+    CHECK(std::equal(histogram, histogram + hll::HISTOGRAM_SIZE, recount));
+    CHECK(sketch.estimate() == hll::estimateFromHistogram(1 << sketch.lgK(), recount));
+    CHECK(sketch.isEmpty() == (recount[0] == (1u << sketch.lgK())));
+}
+
+} // namespace
+
+TEST_CASE(testHistogramFollowsRegisters) {
+    // update(), including the sparse to dense promotion.
+    std::unique_ptr<SketchBase> sketch = sketchOf(12, 0, 20000);
+    checkHistogram(*sketch);
+    std::unique_ptr<SketchBase> empty = hll::makeSketch(12);
+    empty->toDense();
+    checkHistogram(*empty);
+
+    // merge() of dense and sparse sketches, at the same and a larger lgK.
+    sketch->merge(*sketchOf(12, 10000, 40000));
+    checkHistogram(*sketch);
+    sketch->merge(*sketchOf(12, 50000, 50100));
+    checkHistogram(*sketch);
+    sketch->merge(*sketchOf(14, 60000, 90000));
+    checkHistogram(*sketch);
+
+    // mergeDataSketches() of every target type.
+    std::unique_ptr<SketchBase> source = sketchOf(12, 100000, 130000);
+    for (int tgtHllType = 0; tgtHllType < 3; ++tgtHllType) {
+        Bytes image = source->serialize_datasketches(tgtHllType);
+        std::unique_ptr<SketchBase> target = sketchOf(12, 0, 20000);
+        CHECK(target->mergeDataSketches(image.data(), image.size()));
+        checkHistogram(*target);
+    }
+
+    // applyDelta().
+    Bytes baseBlob = sketchOf(12, 0, 20000)->serialize();
+    Bytes newerBlob = sketchOf(12, 0, 60000)->serialize();
+    extension_list_u8_t base = view(baseBlob), newer = view(newerBlob), ret;
+    extension_hll_delta(&base, &newer, &ret);
+    Bytes delta = take(ret);
+    std::unique_ptr<SketchBase> patched = hll::deserialize(baseBlob.data(), baseBlob.size());
+    CHECK(patched->applyDelta(delta.data(), delta.size()));
+    checkHistogram(*patched);
+    CHECK(patched->serialize() == newerBlob);
+
+    // foldTo().
+    std::unique_ptr<SketchBase> folded = sketchOf(16, 0, 50000)->foldTo(10);
+    checkHistogram(*folded);
+
+    // load() of every encoding.
+    for (const Bytes& blob : {sketch->serialize(), sketch->serialize_compact()}) {
+        std::unique_ptr<SketchBase> loaded = hll::deserialize(blob.data(), blob.size());
+        checkHistogram(*loaded);
+        CHECK(registersOf(*loaded) == registersOf(*sketch));
+    }
+}
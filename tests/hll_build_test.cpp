@@ -0,0 +1,43 @@
+// tools/hll_build: hll_build/expected.tsv is what the tool must print for
+// `-H -g 1 -k 2 part1.tsv empty.tsv part2.tsv part3.tsv`, with any number of
+// threads (`make check` compares it). Here it is checked against sketches
+// built row by row with hll_add.
+#include "test_util.h"
+
+#include <algorithm>
+
+using namespace hll_test;
+
+TEST_CASE(testBulkBuilderFixture) {
+    std::map<std::string, extension_state_t> groups;
+    for (const char* name : {"part1.tsv", "empty.tsv", "part2.tsv", "part3.tsv"}) {
+        Bytes file = readFile(std::string("hll_build/") + name);
+        std::istringstream lines(std::string(file.begin(), file.end()));
+        std::string line;
+        std::getline(lines, line);  // header
+        while (std::getline(lines, line)) {
+            size_t tab = line.find('\t');
+            if (tab == std::string::npos || tab + 1 == line.size()) continue;
+            std::string k = line.substr(tab + 1);
+            extension_list_u8_t in{reinterpret_cast<uint8_t*>(k.data()), k.size()};
+            extension_state_t& state = groups[line.substr(0, tab)];
+            if (state == 0) state = extension_hll_empty();
+            state = extension_hll_add(state, &in);
+        }
+    }
+
+    static const char hexDigits[] = "0123456789ABCDEF";
+    std::string expected;
+    for (auto& [group, state] : groups) {
+        expected += group + "\t";
+        for (uint8_t byte : asSketch(state)->serialize()) {
+            expected.push_back(hexDigits[byte >> 4]);
+            expected.push_back(hexDigits[byte & 0x0F]);
+        }
+        expected += "\n";
+        delete asSketch(state);
+    }
+    Bytes tool = readFile("hll_build/expected.tsv");
+    CHECK(groups.size() == 3);
+    CHECK(std::string(tool.begin(), tool.end()) == expected);
+}
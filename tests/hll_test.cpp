@@ -0,0 +1,28 @@
+// Runs the native tests registered by tests/*_test.cpp (`make check`, part of
+// `make test`). Usage: hll_test <fixture dir>
+#include "test_util.h"
+
+using namespace hll_test;
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <fixture dir>\n", argv[0]);
+        return 2;
+    }
+    fixtureDir = argv[1];
+
+    for (const TestCase& test : testCases()) {
+        int before = failures;
+        test.run();
+        if (failures != before) {
+            std::fprintf(stderr, "%s failed\n", test.name);
+        }
+    }
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("PASS (%zu tests)\n", testCases().size());
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Multi-valued inputs: hll_add_agg_split's delimiter splitting and
+// hll_add_agg_json_array's JSON array parsing.
+#include "test_util.h"
+
+using namespace hll_test;
+
+namespace {
+
+using Pieces = std::vector<std::string>;
+
+Pieces split(const std::string& data, const std::string& delimiter) {
+    Pieces pieces;
+    hll::forEachDelimited(reinterpret_cast<const uint8_t*>(data.data()), data.size(),
+                          reinterpret_cast<const uint8_t*>(delimiter.data()), delimiter.size(),
+                          [&](const uint8_t* piece, size_t len) {
+                              pieces.emplace_back(reinterpret_cast<const char*>(piece), len);
+                          });
+    return pieces;
+}
+
+// Elements of a JSON array, or {"<invalid>"} followed by the elements visited
+// before the error.
+Pieces elements(const std::string& json) {
+    Pieces pieces;
+    bool valid = hll::forEachJsonArrayElement(json.data(), json.size(), [&](const uint8_t* element, size_t len) {
+        pieces.emplace_back(reinterpret_cast<const char*>(element), len);
+    });
+    if (!valid) pieces.insert(pieces.begin(), "<invalid>");
+    return pieces;
+}
+
+Registers registersOfKeys(const Pieces& keys) {
+    extension_state_t state = extension_hll_empty();
+    for (std::string k : keys) {
+        extension_list_u8_t in{reinterpret_cast<uint8_t*>(k.data()), k.size()};
+        state = extension_hll_add(state, &in);
+    }
+    Registers registers = registersOf(*asSketch(state));
+    delete asSketch(state);
+    return registers;
+}
+
+Registers registersOfJson(std::string json) {
+    extension_string_t in{json.data(), json.size()};
+    extension_state_t state = extension_hll_add_json_array(extension_hll_empty(), &in);
+    Registers registers = registersOf(*asSketch(state));
+    delete asSketch(state);
+    return registers;
+}
+
+} // namespace
+
+TEST_CASE(testDelimitedPieces) {
+    CHECK((split("red,green,blue", ",") == Pieces{"red", "green", "blue"}));
+    // Empty fields and leading or trailing delimiters yield nothing.
+    CHECK((split(",a,,b,", ",") == Pieces{"a", "b"}));
+    CHECK((split(",,,", ",").empty()));
+    // Multi-byte delimiters, including a partial match and a UTF-8 arrow.
+    CHECK((split("a::b:::c::", "::") == Pieces{"a", "b", ":c"}));
+    CHECK((split("x\xE2\x86\x92y\xE2\x86\x92", "\xE2\x86\x92") == Pieces{"x", "y"}));
+    CHECK((split("a:b", "a:b:c") == Pieces{"a:b"}));
+    // An empty delimiter keeps the value whole; whitespace is part of a piece.
+    CHECK((split("a,b", "") == Pieces{"a,b"}));
+    CHECK((split(" a , b ", ",") == Pieces{" a ", " b "}));
+
+    Bytes list = {'r', 'e', 'd', ';', ';', 'b', 'l', 'u', 'e', ';'};
+    extension_list_u8_t in = view(list);
+    extension_string_t delimiter{const_cast<char*>(";"), 1};
+    extension_state_t state = extension_hll_add_split(extension_hll_empty(), &in, &delimiter);
+    CHECK(registersOf(*asSketch(state)) == registersOfKeys({"red", "blue"}));
+    delete asSketch(state);
+}
+
+TEST_CASE(testJsonArrayElements) {
+    CHECK((elements("[\"a\", \"b\"]") == Pieces{"a", "b"}));
+    CHECK((elements("[1,-2.5e3,true,false,null]") == Pieces{"1", "-2.5e3", "true", "false"}));
+    // Empty arrays, with and without whitespace, and surrounding whitespace.
+    CHECK((elements("[]").empty()));
+    CHECK((elements(" \n[ \t]").empty()));
+    CHECK((elements("\r\n[ 1 ,\t\"x\" \n] ") == Pieces{"1", "x"}));
+    // Escapes are decoded, including surrogate pairs; an empty string is visited.
+    CHECK((elements("[\"a\\\"b\",\"x\\\\y\",\"\\u00e9\\n\",\"\\ud83d\\ude00\",\"\"]") ==
+           Pieces{"a\"b", "x\\y", "\xC3\xA9\n", "\xF0\x9F\x98\x80", ""}));
+    // Nested arrays and objects are passed as their JSON text, brackets inside
+    // strings included.
+    CHECK((elements("[[1,\"]\"], {\"a\": [2, {}]}, []]") ==
+           Pieces{"[1,\"]\"]", "{\"a\": [2, {}]}", "[]"}));
+
+    // Malformed input stops at the error.
+    CHECK((elements("[1,2,\"x") == Pieces{"<invalid>", "1", "2"}));
+    CHECK((elements("[1,2,]") == Pieces{"<invalid>", "1", "2"}));
+    CHECK((elements("[1 2]") == Pieces{"<invalid>", "1"}));
+    CHECK((elements("[[1,2]") == Pieces{"<invalid>", "[1,2]"}));
+    CHECK((elements("[[1,\"]]") == Pieces{"<invalid>"}));
+    CHECK((elements("[\"\\q\"]") == Pieces{"<invalid>"}));
+    CHECK((elements("{\"a\":1}") == Pieces{"<invalid>"}));
+    CHECK((elements("") == Pieces{"<invalid>"}));
+}
+
+TEST_CASE(testJsonArrayIsAllOrNothing) {
+    CHECK(registersOfJson("[\"a\", \"b\", 3, null, \"\"]") == registersOfKeys({"a", "b", "3"}));
+    CHECK(registersOfJson("[\"\\u0061\"]") == registersOfKeys({"a"}));
+    CHECK(registersOfJson("[1,2,\"x").empty());
+    CHECK(registersOfJson("[\"a\",\"b\"").empty());
+    CHECK(registersOfJson("[\"a\",\"\\x\"]").empty());
+
+    // A malformed row leaves the rows before it untouched.
+    std::string good = "[\"a\"]", bad = "[\"b\",";
+    extension_string_t in{good.data(), good.size()};
+    extension_state_t state = extension_hll_add_json_array(extension_hll_empty(), &in);
+    in = {bad.data(), bad.size()};
+    state = extension_hll_add_json_array(state, &in);
+    CHECK(registersOf(*asSketch(state)) == registersOfKeys({"a"}));
+    delete asSketch(state);
+}
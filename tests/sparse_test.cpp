@@ -0,0 +1,98 @@
+// High-precision sparse blobs (SER_VER 3/4), blobs of earlier releases and
+// cached estimates.
+#include <algorithm>
+#include "test_util.h"
+
+using namespace hll_test;
+
+TEST_CASE(testHighPrecisionSparse) {
+    std::unique_ptr<SketchBase> sketch = sketchOf(12, 0, 100);
+    CHECK(sketch->isSparse());
+    for (int layout = 0; layout < 4; ++layout) {
+        bool compact = layout & 1;
+        bool cached = layout & 2;
+        Bytes blob = compact ? sketch->serialize_compact(cached) : sketch->serialize(cached);
+        CHECK(blob[1] == (cached ? hll::CACHED_SPARSE_SER_VER_BYTE : hll::SPARSE_SER_VER_BYTE));
+        CHECK(hll::isCompactEncoding(blob.data(), blob.size()) == compact);
+        std::unique_ptr<SketchBase> loaded = hll::deserialize(blob.data(), blob.size());
+        CHECK(loaded && loaded->isSparse() && loaded->registerLgK() == hll::SPARSE_LG_K);
+        if (!loaded) continue;
+        CHECK((compact ? loaded->serialize_compact(cached) : loaded->serialize(cached)) == blob);
+        CHECK(loaded->estimate() == sketch->estimate());
+
+        hll::Stats stats;
+        uint32_t histogram[hll::HISTOGRAM_SIZE];
+        sketch->computeHistogram(histogram);
+        CHECK(hll::scanStats(blob.data(), blob.size(), stats));
+        CHECK(std::equal(histogram, histogram + hll::HISTOGRAM_SIZE, stats.histogram));
+    }
+}
+
+TEST_CASE(testScanStatsFoldsCoupons) {
+    // Coupons 1 and 2 share lgK 12 register 0x80 at 25-bit precision, coupon 3
+    // is the next register; the histogram must count the larger value once.
+    std::unique_ptr<SketchBase> sketch = hll::makeSketch(12);
+    sketch->updateWithHash((uint64_t(0x100000) << 39) | (uint64_t(1) << 30));
+    sketch->updateWithHash((uint64_t(0x100001) << 39) | (uint64_t(1) << 35));
+    sketch->updateWithHash((uint64_t(0x102000) << 39) | 1);
+    uint32_t histogram[hll::HISTOGRAM_SIZE];
+    sketch->computeHistogram(histogram);
+    for (int compact = 0; compact < 2; ++compact) {
+        Bytes blob = compact ? sketch->serialize_compact() : sketch->serialize();
+        hll::Stats stats;
+        CHECK(hll::scanStats(blob.data(), blob.size(), stats));
+        CHECK(stats.numNonZero == 2 && stats.numCoupons == 3);
+        CHECK(std::equal(histogram, histogram + hll::HISTOGRAM_SIZE, stats.histogram));
+    }
+
+    // Coupons out of slot order are rejected rather than miscounted.
+    Bytes unsorted = hll::makeSketch(12)->serialize();
+    unsorted.back() = 2;
+    unsorted.insert(unsorted.end(), {9, 1, 5, 1});
+    hll::Stats stats;
+    CHECK(!hll::scanStats(unsorted.data(), unsorted.size(), stats));
+}
+
+TEST_CASE(testCachedEstimates) {
+    // A cached sparse sketch that turns dense must not keep the sparse estimate.
+    std::unique_ptr<SketchBase> sketch = sketchOf(12, 0, 200);
+    Bytes cached = sketch->serialize(true);
+    std::unique_ptr<SketchBase> loaded = hll::deserialize(cached.data(), cached.size());
+    CHECK(loaded && loaded->estimate() == sketch->estimate());
+    if (loaded) {
+        loaded->toDense();
+        sketch->toDense();
+        CHECK(loaded->estimate() == sketch->estimate());
+    }
+
+    // Cached dense blobs still use the stored estimate once loaded.
+    std::unique_ptr<SketchBase> dense = sketchOf(12, 0, 5000);
+    Bytes denseCached = dense->serialize(true);
+    double marker = 12345.0;
+    std::memcpy(&denseCached[hll::CACHED_ESTIMATE_OFFSET], &marker, sizeof(double));
+    loaded = hll::deserialize(denseCached.data(), denseCached.size());
+    CHECK(loaded && loaded->estimate() == marker);
+}
+
+TEST_CASE(testLegacyBlobs) {
+    const char* fixtures[] = {"legacy_v1_sparse_lgk12.bin", "legacy_v1_sparse_compact_lgk12.bin",
+                              "legacy_v1_dense_lgk12.bin", "legacy_v1_dense_compact_lgk12.bin"};
+    for (const char* name : fixtures) {
+        Bytes blob = readFile(std::string("legacy/") + name);
+        CHECK(blob[1] == 1);
+        std::unique_ptr<SketchBase> sketch = hll::deserialize(blob.data(), blob.size());
+        CHECK(sketch && sketch->lgK() == 12);
+        if (!sketch) continue;
+        bool compact = hll::isCompactEncoding(blob.data(), blob.size());
+        CHECK((compact ? sketch->serialize_compact() : sketch->serialize()) == blob);
+    }
+
+    // The legacy blobs hold key0..key4999; today's dense sketch must match.
+    extension_state_t state = addKeys(extension_hll_empty(), 0, 5000);
+    extension_list_u8_t ret;
+    extension_hll_serialize(state, &ret);
+    CHECK(take(ret) == readFile("legacy/legacy_v1_dense_lgk12.bin"));
+    extension_hll_serialize_compact(state, &ret);
+    CHECK(take(ret) == readFile("legacy/legacy_v1_dense_compact_lgk12.bin"));
+    delete asSketch(state);
+}
@@ -0,0 +1,46 @@
+// Internal transport states (serializeState/deserializeState) and the bounds
+// checked when loading them and sparse blobs.
+#include "test_util.h"
+
+using namespace hll_test;
+
+TEST_CASE(testStateRoundTrip) {
+    std::unique_ptr<SketchBase> sparse = sketchOf(14, 0, 300);
+    std::unique_ptr<SketchBase> dense = sketchOf(14, 0, 20000);
+    std::unique_ptr<SketchBase> folded = dense->foldTo(10);
+    for (const SketchBase* sketch : {sparse.get(), dense.get(), folded.get()}) {
+        Bytes state = sketch->serializeState();
+        CHECK(state[0] == hll::STATE_FORMAT_BYTE);
+        std::unique_ptr<SketchBase> loaded = hll::deserializeState(state.data(), state.size());
+        CHECK(loaded != nullptr);
+        if (!loaded) continue;
+        CHECK(loaded->lgK() == sketch->lgK());
+        CHECK(loaded->isDense() == sketch->isDense());
+        CHECK(loaded->isReducedPrecision() == sketch->isReducedPrecision());
+        CHECK(loaded->serialize() == sketch->serialize());
+        CHECK(hll::deserializeState(state.data(), state.size() - 1) == nullptr);
+    }
+}
+
+TEST_CASE(testRejectsOversizeValues) {
+    // One coupon at slot 5 of a high-precision sparse lgK 12 sketch; 40 is the
+    // largest value a 25-bit slot leaves room for.
+    for (uint8_t value : {40, 41, 127}) {
+        Bytes blob = sketchOf(12, 0, 0)->serialize();
+        blob.back() = 1;
+        blob.insert(blob.end(), {5, value});
+        std::unique_ptr<SketchBase> loaded = hll::deserialize(blob.data(), blob.size());
+        CHECK((loaded != nullptr) == (value == 40));
+
+        Bytes compact = sketchOf(12, 0, 0)->serialize_compact();
+        compact.back() = 1;
+        hll::writeVarInt(compact, (5u << hll::VALUE_BITS) | value);
+        loaded = hll::deserialize(compact.data(), compact.size());
+        CHECK((loaded != nullptr) == (value == 40));
+
+        Bytes state = sketchOf(12, 0, 1)->serializeState();
+        state.back() = value;
+        loaded = hll::deserializeState(state.data(), state.size());
+        CHECK((loaded != nullptr) == (value == 40));
+    }
+}
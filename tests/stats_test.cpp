@@ -0,0 +1,54 @@
+// hll_stats: the JSON description of a serialized sketch.
+#include "test_util.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace hll_test;
+
+namespace {
+
+std::string statsOf(const Bytes& blob) {
+    extension_list_u8_t data = view(blob);
+    extension_string_t ret{};
+    extension_hll_stats(&data, &ret);
+    return take(ret);
+}
+
+} // namespace
+
+TEST_CASE(testStatsJson) {
+    std::string json = statsOf(sketchOf(14, 0, 50000)->serialize());
+    CHECK(json.rfind("{\"mode\":\"dense\",\"lg_k\":14,\"k\":16384,", 0) == 0);
+    CHECK(json.find("\"reduced_precision\":false") != std::string::npos);
+    CHECK(json.find("\"estimator\":\"") != std::string::npos);
+    CHECK(json.back() == '}');
+
+    // A high-precision sparse sketch reports the error of its lgK, not of the
+    // 25-bit coupons.
+    for (int lgK : {10, 12, 16}) {
+        json = statsOf(sketchOf(lgK, 0, 50)->serialize());
+        CHECK(json.find("\"estimator\":\"sparse_linear_counting\"") != std::string::npos);
+        char expected[64];
+        snprintf(expected, sizeof(expected), "\"relative_standard_error\":%.6g}",
+                 1.04 / std::sqrt(double(1 << lgK)));
+        CHECK(json.size() >= strlen(expected) &&
+              json.compare(json.size() - strlen(expected), std::string::npos, expected) == 0);
+    }
+
+    // Every histogram bucket in use with ten-digit counts: the JSON must come
+    // back whole however long it gets.
+    hll::Stats stats = {};
+    stats.lgK = 21;
+    stats.sparseLgK = hll::SPARSE_LG_K;
+    stats.isDense = true;
+    std::fill(stats.histogram, stats.histogram + hll::HISTOGRAM_SIZE, 4000000000u);
+    json = hll::formatStats(stats, 1u << 21);
+    CHECK(json.size() > 900);
+    size_t histogram = json.find("\"histogram\":[");
+    size_t end = json.find(']', histogram);
+    CHECK(histogram != std::string::npos && end != std::string::npos);
+    CHECK(std::count(json.begin() + histogram, json.begin() + end, ',') == hll::HISTOGRAM_SIZE - 1);
+    CHECK(json.find("\"relative_standard_error\":") != std::string::npos);
+    CHECK(json.back() == '}');
+}
@@ -0,0 +1,141 @@
+#ifndef HLL_TEST_UTIL_H
+#define HLL_TEST_UTIL_H
+
+// Shared helpers of the native tests. Each tests/*_test.cpp file registers its
+// cases with TEST_CASE; hll_test.cpp runs them all (`make check`).
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <hll_sketch.h>
+#include <extension.h>
+
+namespace hll_test {
+
+using hll::SketchBase;
+using Bytes = std::vector<uint8_t>;
+using Registers = std::map<uint32_t, uint8_t>;
+
+inline int failures = 0;
+inline std::string fixtureDir;
+
+#define CHECK(cond)                                                      \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+                         __LINE__, #cond);                               \
+            hll_test::failures++;                                        \
+        }                                                                \
+    } while (0)
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+inline std::vector<TestCase>& testCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, void (*run)()) { testCases().push_back({name, run}); }
+};
+
+#define TEST_CASE(name)                                                    \
+    static void name();                                                    \
+    static const hll_test::TestRegistrar name##Registrar(#name, name);     \
+    static void name()
+
+inline Bytes readFile(const std::string& name) {
+    std::ifstream in(fixtureDir + "/" + name, std::ios::binary);
+    if (!in) {
+        std::fprintf(stderr, "missing fixture %s\n", name.c_str());
+        std::exit(1);
+    }
+    return Bytes(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Fixture .txt files: '#' comment lines, the lgK, then "slot value" lines.
+inline Registers readExpected(const std::string& name, int& lgK) {
+    Bytes text = readFile(name);
+    std::istringstream in(std::string(text.begin(), text.end()));
+    std::string line;
+    Registers registers;
+    lgK = -1;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        if (lgK < 0) {
+            fields >> lgK;
+            continue;
+        }
+        uint32_t slot;
+        int value;
+        fields >> slot >> value;
+        registers[slot] = static_cast<uint8_t>(value);
+    }
+    return registers;
+}
+
+// Non-zero registers at lgK precision, whatever mode the sketch is in.
+inline Registers registersOf(const SketchBase& sketch) {
+    std::unique_ptr<SketchBase> dense = sketch.clone();
+    dense->toDense();
+    Registers registers;
+    dense->forEachRegister([&](uint32_t slot, uint8_t value) { registers[slot] = value; });
+    return registers;
+}
+
+// Wraps the extension's out-parameter blob calls.
+inline Bytes take(extension_list_u8_t& ret) {
+    Bytes result(ret.ptr, ret.ptr + ret.len);
+    std::free(ret.ptr);
+    return result;
+}
+
+inline std::string take(extension_string_t& ret) {
+    std::string result(ret.ptr, ret.len);
+    std::free(ret.ptr);
+    return result;
+}
+
+inline extension_list_u8_t view(const Bytes& bytes) {
+    return extension_list_u8_t{const_cast<uint8_t*>(bytes.data()), bytes.size()};
+}
+
+inline std::string key(int i) { return "key" + std::to_string(i); }
+
+inline std::unique_ptr<SketchBase> sketchOf(int lgK, int from, int to) {
+    std::unique_ptr<SketchBase> sketch = hll::makeSketch(lgK);
+    for (int i = from; i < to; ++i) {
+        std::string k = key(i);
+        sketch->update(reinterpret_cast<const uint8_t*>(k.data()), k.size());
+    }
+    return sketch;
+}
+
+inline extension_state_t addKeys(extension_state_t state, int from, int to) {
+    for (int i = from; i < to; ++i) {
+        std::string k = key(i);
+        extension_list_u8_t in{reinterpret_cast<uint8_t*>(k.data()), k.size()};
+        state = extension_hll_add(state, &in);
+    }
+    return state;
+}
+
+inline SketchBase* asSketch(extension_state_t state) { return reinterpret_cast<SketchBase*>(state); }
+
+inline extension_state_t asState(SketchBase* sketch) { return reinterpret_cast<extension_state_t>(sketch); }
+
+} // namespace hll_test
+
+#endif // HLL_TEST_UTIL_H
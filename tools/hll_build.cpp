@@ -0,0 +1,423 @@
+// Offline bulk builder: reads CSV, TSV or one-key-per-line files, builds one
+// sketch per group in parallel and prints a TSV ready for LOAD DATA, with the
+// group columns followed by the hex-encoded sketch. Keys are hashed exactly as
+// hll_add_agg hashes them, so the blobs are byte-identical to the extension's.
+//
+//   make tools && ./build/hll_build -k 3 -g 1,2 events.tsv > sketches.tsv
+//
+//   LOAD DATA LOCAL INFILE 'sketches.tsv' INTO TABLE daily_users
+//   FIELDS TERMINATED BY '\t' (day, country, @sketch) SET sketch = UNHEX(@sketch);
+
+#include <hll_sketch.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+enum class Format { Lines, Tsv, Csv };
+
+struct Options {
+    Format format = Format::Tsv;
+    bool formatSet = false;
+    int keyColumn = 1;
+    std::vector<int> groupColumns;
+    int lgK = hll::DEFAULT_LG_K;
+    bool compact = false;
+    bool skipHeader = false;
+    int threads = 0;
+    std::vector<const char*> inputs;
+};
+
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+struct Chunk {
+    const MappedFile* file;
+    size_t begin;
+    size_t end;
+};
+
+using SketchMap = std::unordered_map<std::string, std::unique_ptr<hll::SketchBase>>;
+
+constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+void usage() {
+    fprintf(stderr,
+        "usage: hll_build [options] FILE...\n"
+        "  -f lines|tsv|csv  input format (default: from the file extension, else tsv)\n"
+        "  -k N              key column, 1-based (default 1)\n"
+        "  -g N[,N...]       group-by columns, 1-based (default: one sketch for everything)\n"
+        "  -l LGK            sketch precision, %d-%d (default %d)\n"
+        "  -c                write serialize_compact blobs (default: standard serialize)\n"
+        "  -H                skip the first line of every file\n"
+        "  -t N              worker threads (default: hardware threads)\n",
+        hll::MIN_LG_K, hll::MAX_LG_K, hll::DEFAULT_LG_K);
+}
+
+bool parseColumns(const char* text, std::vector<int>& columns) {
+    while (*text != '\0') {
+        char* end;
+        long column = strtol(text, &end, 10);
+        if (end == text || column < 1) return false;
+        columns.push_back(static_cast<int>(column));
+        text = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return false;
+    }
+    return !columns.empty();
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    int opt;
+    while ((opt = getopt(argc, argv, "f:k:g:l:cHt:")) != -1) {
+        switch (opt) {
+            case 'f':
+                options.formatSet = true;
+                if (strcmp(optarg, "lines") == 0) options.format = Format::Lines;
+                else if (strcmp(optarg, "tsv") == 0) options.format = Format::Tsv;
+                else if (strcmp(optarg, "csv") == 0) options.format = Format::Csv;
+                else return false;
+                break;
+            case 'k':
+                options.keyColumn = atoi(optarg);
+                if (options.keyColumn < 1) return false;
+                break;
+            case 'g':
+                if (!parseColumns(optarg, options.groupColumns)) return false;
+                break;
+            case 'l':
+                options.lgK = atoi(optarg);
+                if (options.lgK < hll::MIN_LG_K || options.lgK > hll::MAX_LG_K) return false;
+                break;
+            case 'c': options.compact = true; break;
+            case 'H': options.skipHeader = true; break;
+            case 't': options.threads = atoi(optarg); break;
+            default: return false;
+        }
+    }
+    for (int i = optind; i < argc; ++i) {
+        options.inputs.push_back(argv[i]);
+    }
+    if (options.inputs.empty()) return false;
+
+    if (!options.formatSet) {
+        const char* dot = strrchr(options.inputs[0], '.');
+        if (dot != nullptr && strcmp(dot, ".csv") == 0) options.format = Format::Csv;
+    }
+    if (options.format == Format::Lines && (options.keyColumn != 1 || !options.groupColumns.empty())) {
+        fprintf(stderr, "hll_build: line input has a single column\n");
+        return false;
+    }
+    if (options.threads <= 0) {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return true;
+}
+
+bool mapFile(const char* path, MappedFile& file) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    file.size = static_cast<size_t>(st.st_size);
+    if (file.size > 0) {
+        void* data = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror(path);
+            close(fd);
+            return false;
+        }
+        madvise(data, file.size, MADV_SEQUENTIAL);
+        file.data = static_cast<const char*>(data);
+    }
+    close(fd);
+    return true;
+}
+
+// Cuts every file into pieces of roughly equal size that start at a line.
+std::vector<Chunk> makeChunks(const std::vector<MappedFile>& files, int threads, bool skipHeader) {
+    size_t total = 0;
+    for (const MappedFile& file : files) total += file.size;
+    size_t target = std::max(MIN_CHUNK_BYTES, total / (static_cast<size_t>(threads) * 4) + 1);
+
+    std::vector<Chunk> chunks;
+    for (const MappedFile& file : files) {
+        if (file.size == 0) continue;
+        size_t pos = 0;
+        if (skipHeader) {
+            const void* newline = memchr(file.data, '\n', file.size);
+            pos = newline ? static_cast<const char*>(newline) - file.data + 1 : file.size;
+        }
+        while (pos < file.size) {
+            size_t end = std::min(file.size, pos + target);
+            if (end < file.size) {
+                const void* newline = memchr(file.data + end, '\n', file.size - end);
+                end = newline ? static_cast<const char*>(newline) - file.data + 1 : file.size;
+            }
+            chunks.push_back({&file, pos, end});
+            pos = end;
+        }
+    }
+    return chunks;
+}
+
+// MySQL LOAD DATA escapes, as written by SELECT ... INTO OUTFILE.
+char unescapeTsv(char c) {
+    switch (c) {
+        case '0': return '\0';
+        case 'b': return '\b';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 't': return '\t';
+        case 'Z': return '\x1a';
+        default: return c;
+    }
+}
+
+// Splits one line into decoded fields. A TSV field that is exactly \N is NULL
+// and comes back as null[i] = true.
+void splitLine(const char* line, size_t len, Format format,
+               std::vector<std::string>& fields, std::vector<bool>& nulls) {
+    fields.clear();
+    nulls.clear();
+    if (format == Format::Lines) {
+        fields.emplace_back(line, len);
+        nulls.push_back(false);
+        return;
+    }
+    size_t pos = 0;
+    while (true) {
+        std::string field;
+        bool isNull = false;
+        if (format == Format::Tsv) {
+            size_t start = pos;
+            while (pos < len && line[pos] != '\t') {
+                if (line[pos] == '\\' && pos + 1 < len) {
+                    field.push_back(unescapeTsv(line[pos + 1]));
+                    pos += 2;
+                } else {
+                    field.push_back(line[pos++]);
+                }
+            }
+            isNull = pos - start == 2 && line[start] == '\\' && line[start + 1] == 'N';
+        } else if (pos < len && line[pos] == '"') {
+            pos++;
+            while (pos < len) {
+                if (line[pos] == '"') {
+                    if (pos + 1 < len && line[pos + 1] == '"') {
+                        field.push_back('"');
+                        pos += 2;
+                        continue;
+                    }
+                    pos++;
+                    break;
+                }
+                field.push_back(line[pos++]);
+            }
+            while (pos < len && line[pos] != ',') pos++;
+        } else {
+            size_t start = pos;
+            while (pos < len && line[pos] != ',') pos++;
+            field.assign(line + start, pos - start);
+        }
+        fields.push_back(std::move(field));
+        nulls.push_back(isNull);
+        if (pos >= len) break;
+        pos++;
+    }
+}
+
+// Escapes a group value for the TSV output so LOAD DATA reads it back unchanged.
+void appendEscaped(std::string& out, const std::string& value) {
+    for (char c : value) {
+        switch (c) {
+            case '\0': out += "\\0"; break;
+            case '\t': out += "\\t"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\\': out += "\\\\"; break;
+            default: out.push_back(c);
+        }
+    }
+}
+
+struct Worker {
+    std::vector<SketchMap> partitions;
+    uint64_t rows = 0;
+    uint64_t skipped = 0;
+};
+
+void processChunk(const Chunk& chunk, const Options& options, Worker& worker) {
+    std::vector<std::string> fields;
+    std::vector<bool> nulls;
+    std::string groupKey;
+    std::hash<std::string> hasher;
+    size_t numPartitions = worker.partitions.size();
+
+    const char* data = chunk.file->data;
+    size_t pos = chunk.begin;
+    while (pos < chunk.end) {
+        const void* newline = memchr(data + pos, '\n', chunk.end - pos);
+        size_t lineEnd = newline ? static_cast<const char*>(newline) - data : chunk.end;
+        size_t len = lineEnd - pos;
+        if (len > 0 && data[pos + len - 1] == '\r') len--;
+        const char* line = data + pos;
+        pos = lineEnd + 1;
+        if (len == 0) continue;
+
+        splitLine(line, len, options.format, fields, nulls);
+        worker.rows++;
+
+        size_t keyIndex = options.keyColumn - 1;
+        if (keyIndex >= fields.size() || nulls[keyIndex] || fields[keyIndex].empty()) {
+            worker.skipped++;
+            continue;
+        }
+        groupKey.clear();
+        bool missingGroup = false;
+        for (size_t i = 0; i < options.groupColumns.size(); ++i) {
+            size_t column = options.groupColumns[i] - 1;
+            if (column >= fields.size()) {
+                missingGroup = true;
+                break;
+            }
+            if (i > 0) groupKey.push_back('\t');
+            if (nulls[column]) {
+                groupKey += "\\N";
+            } else {
+                appendEscaped(groupKey, fields[column]);
+            }
+        }
+        if (missingGroup) {
+            worker.skipped++;
+            continue;
+        }
+
+        SketchMap& partition = worker.partitions[hasher(groupKey) % numPartitions];
+        std::unique_ptr<hll::SketchBase>& sketch = partition[groupKey];
+        if (!sketch) {
+            sketch = hll::makeSketch(options.lgK);
+        }
+        const std::string& key = fields[keyIndex];
+        sketch->update(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    std::vector<MappedFile> files(options.inputs.size());
+    for (size_t i = 0; i < options.inputs.size(); ++i) {
+        if (!mapFile(options.inputs[i], files[i])) {
+            return 1;
+        }
+    }
+    std::vector<Chunk> chunks = makeChunks(files, options.threads, options.skipHeader);
+    int numThreads = std::max(1, std::min(options.threads, static_cast<int>(chunks.size())));
+
+    // Each worker splits its groups into one partition per thread, so the
+    // merge below runs in parallel without any locking.
+    std::vector<Worker> workers(numThreads);
+    for (Worker& worker : workers) {
+        worker.partitions.resize(numThreads);
+    }
+    std::atomic<size_t> nextChunk(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = nextChunk++; i < chunks.size(); i = nextChunk++) {
+                processChunk(chunks[i], options, workers[t]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    threads.clear();
+
+    for (int p = 0; p < numThreads; ++p) {
+        threads.emplace_back([&, p] {
+            SketchMap& target = workers[0].partitions[p];
+            for (int t = 1; t < numThreads; ++t) {
+                for (auto& entry : workers[t].partitions[p]) {
+                    std::unique_ptr<hll::SketchBase>& sketch = target[entry.first];
+                    if (!sketch) {
+                        sketch = std::move(entry.second);
+                    } else {
+                        sketch->merge(*entry.second);
+                    }
+                }
+                workers[t].partitions[p].clear();
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    std::vector<std::pair<const std::string*, const hll::SketchBase*>> groups;
+    for (const SketchMap& partition : workers[0].partitions) {
+        for (const auto& entry : partition) {
+            groups.emplace_back(&entry.first, entry.second.get());
+        }
+    }
+    std::sort(groups.begin(), groups.end(),
+              [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+    static const char hexDigits[] = "0123456789ABCDEF";
+    std::string line;
+    for (const auto& group : groups) {
+        std::vector<uint8_t> blob = options.compact ? group.second->serialize_compact()
+                                                    : group.second->serialize();
+        line.clear();
+        if (!options.groupColumns.empty()) {
+            line += *group.first;
+            line.push_back('\t');
+        }
+        for (uint8_t byte : blob) {
+            line.push_back(hexDigits[byte >> 4]);
+            line.push_back(hexDigits[byte & 0x0F]);
+        }
+        line.push_back('\n');
+        fwrite(line.data(), 1, line.size(), stdout);
+    }
+
+    uint64_t rows = 0;
+    uint64_t skipped = 0;
+    for (const Worker& worker : workers) {
+        rows += worker.rows;
+        skipped += worker.skipped;
+    }
+    fprintf(stderr, "hll_build: %llu rows, %llu skipped, %zu groups, %d threads\n",
+            static_cast<unsigned long long>(rows), static_cast<unsigned long long>(skipped),
+            groups.size(), numThreads);
+
+    for (const MappedFile& file : files) {
+        if (file.size > 0) munmap(const_cast<char*>(file.data), file.size);
+    }
+    return 0;
+}